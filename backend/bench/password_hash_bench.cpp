@@ -0,0 +1,63 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Measures password hashing throughput on the hashing WorkerPool
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils/password_hasher.hpp"
+#include "utils/worker_pool.hpp"
+
+namespace {
+
+// Hashes `count` passwords on a pool of `threads` workers and returns the
+// elapsed wall-clock time in seconds.
+double run(const PasswordHasher& hasher, std::size_t threads, int count) {
+  const auto start = std::chrono::steady_clock::now();
+  {
+    WorkerPool pool("bench", threads, count);
+    for (int i = 0; i < count; ++i) {
+      pool.try_submit(
+          [&hasher, i] { hasher.hash("password" + std::to_string(i)); });
+    }
+    // The destructor runs every queued task before joining
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+}  // namespace
+
+// Usage: password_hash_bench [iterations] [hashes per thread]
+//
+// Reports hashes/second for one worker and for one worker per core, which
+// is how PASSWORD_HASH_THREADS and PASSWORD_HASH_ITERATIONS are sized: the
+// per-core rate is the login/signup rate each core can sustain.
+int main(int argc, char** argv) {
+  const int iterations = argc > 1 ? std::atoi(argv[1]) : 310000;
+  const int per_thread = argc > 2 ? std::atoi(argv[2]) : 20;
+  const std::size_t cores =
+      std::max(1u, std::thread::hardware_concurrency());
+
+  PasswordHasher hasher(iterations);
+  std::printf("PBKDF2-HMAC-SHA256, %d iterations, %zu cores\n",
+              hasher.iterations(), cores);
+
+  std::vector<std::size_t> thread_counts = {1};
+  if (cores > 1) thread_counts.push_back(cores);
+
+  for (std::size_t threads : thread_counts) {
+    const int count = per_thread * static_cast<int>(threads);
+    const double seconds = run(hasher, threads, count);
+    const double rate = count / seconds;
+    std::printf("%3zu threads: %8.1f hashes/s  %8.1f hashes/s per core  "
+                "%7.2f ms per hash\n",
+                threads, rate, rate / threads, 1000.0 * threads / rate);
+  }
+  return 0;
+}
@@ -0,0 +1,102 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Measures spatial grid queries and moves as the entity count grows
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "game/random.hpp"
+#include "game/spatial_grid.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double nanoseconds(Clock::duration elapsed) {
+  return std::chrono::duration<double, std::nano>(elapsed).count();
+}
+
+constexpr int kTilesPerEntity = 16;
+constexpr int kRadius = 8;
+constexpr int kQueries = 200000;
+constexpr int kMoves = 1000000;
+
+void run(std::uint32_t entities, unsigned cell_bits) {
+  // The map grows with the entity count, so every query sees about the
+  // same number of neighbours and any growth in cost is the index's
+  const auto side = static_cast<std::uint16_t>(
+      std::ceil(std::sqrt(static_cast<double>(entities) * kTilesPerEntity)));
+  SpatialGrid grid(side, side, cell_bits);
+  Random rng(42);
+  std::vector<GridEntry> positions(entities);
+  for (std::uint32_t id = 0; id < entities; ++id) {
+    positions[id] = {id, static_cast<std::uint16_t>(rng.below(side)),
+                     static_cast<std::uint16_t>(rng.below(side))};
+    grid.insert(id, positions[id].x, positions[id].y);
+  }
+
+  // One tile steps, as players walk
+  auto start = Clock::now();
+  for (int i = 0; i < kMoves; ++i) {
+    GridEntry& entity = positions[rng.below(entities)];
+    const int x = entity.x + static_cast<int>(rng.below(3)) - 1;
+    const int y = entity.y + static_cast<int>(rng.below(3)) - 1;
+    if (x < 0 || y < 0 || x >= side || y >= side) continue;
+    entity.x = static_cast<std::uint16_t>(x);
+    entity.y = static_cast<std::uint16_t>(y);
+    grid.move(entity.id, entity.x, entity.y);
+  }
+  const double move_ns = nanoseconds(Clock::now() - start) / kMoves;
+
+  std::vector<GridEntry> found;
+  std::size_t results = 0;
+  start = Clock::now();
+  for (int i = 0; i < kQueries; ++i) {
+    grid.query_radius(rng.below(side), rng.below(side), kRadius, found);
+    results += found.size();
+  }
+  const double query_ns = nanoseconds(Clock::now() - start) / kQueries;
+
+  // The same query over a flat array, as the browser does today
+  const int scans = entities > 100000 ? 100 : 1000;
+  std::size_t scanned = 0;
+  start = Clock::now();
+  for (int i = 0; i < scans; ++i) {
+    const int x = rng.below(side);
+    const int y = rng.below(side);
+    found.clear();
+    for (const GridEntry& entity : positions) {
+      const int dx = entity.x - x;
+      const int dy = entity.y - y;
+      if (dx * dx + dy * dy <= kRadius * kRadius) found.push_back(entity);
+    }
+    scanned += found.size();
+  }
+  const double scan_ns = nanoseconds(Clock::now() - start) / scans;
+
+  std::printf("%8u %6u %9.1f %10.1f %12.1f %8.2f %8.1f\n", entities, side,
+              static_cast<double>(results) / kQueries, query_ns, scan_ns,
+              move_ns, static_cast<double>(grid.bytes()) / entities);
+  if (scanned == SIZE_MAX) std::printf(" ");  // Keeps the scan alive
+}
+
+}  // namespace
+
+// Usage: spatial_grid_bench [cell_bits]
+//
+// Fills maps of growing size with one entity per 16 tiles, then times
+// radius-8 queries against the grid and against a linear scan, and one
+// tile moves. Grid query cost should stay flat while the scan grows with
+// the entity count.
+int main(int argc, char** argv) {
+  const unsigned cell_bits = argc > 1 ? std::atoi(argv[1]) : 3;
+  std::printf("cells of %u tiles, radius %d\n", 1u << cell_bits, kRadius);
+  std::printf("%8s %6s %9s %10s %12s %8s %8s\n", "entities", "side", "found",
+              "query ns", "scan ns", "move ns", "B/entity");
+  for (std::uint32_t entities : {1000u, 10000u, 100000u, 500000u}) {
+    run(entities, cell_bits);
+  }
+  return 0;
+}
@@ -0,0 +1,106 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Measures the per-tick cost and memory of the spawn engine
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "game/encounter_table.hpp"
+#include "game/random.hpp"
+#include "game/spawn_engine.hpp"
+#include "game/zone.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double nanoseconds(Clock::duration elapsed) {
+  return std::chrono::duration<double, std::nano>(elapsed).count();
+}
+
+// Mean cost of one EncounterTable::draw with the given species already out
+double draw_ns(const EncounterTable& table,
+               const std::vector<std::uint16_t>& present) {
+  constexpr int kDraws = 1000000;
+  Random rng(7);
+  std::uint32_t sink = 0;
+  const auto start = Clock::now();
+  for (int i = 0; i < kDraws; ++i) sink += table.draw(rng, present)->species;
+  const double elapsed = nanoseconds(Clock::now() - start);
+  if (sink == 0) std::printf(" ");  // Keeps the loop from being dropped
+  return elapsed / kDraws;
+}
+
+}  // namespace
+
+// Usage: spawn_engine_bench [zones] [ticks]
+//
+// Builds `zones` live instances of the meadow zone, ticks them until the
+// spawns reach a steady state, then reports the cost of each further tick
+// and the memory per zone. This is what sizes SPAWN_ZONES against
+// SPAWN_TICK_MS: a tick must stay well under the tick period.
+int main(int argc, char** argv) {
+  const std::size_t zones = argc > 1 ? std::strtoul(argv[1], nullptr, 10)
+                                     : 10000;
+  const int ticks = argc > 2 ? std::atoi(argv[2]) : 1000;
+
+  const ZoneTemplate meadow = meadow_zone();
+  const auto build_start = Clock::now();
+  SpawnEngine engine({{meadow, zones}}, 42);
+  const double build_ms = nanoseconds(Clock::now() - build_start) / 1e6;
+
+  // Lifetimes are at most max_lifetime ticks, so after twice that the
+  // number of live spawns no longer depends on the empty start
+  for (std::uint32_t i = 0; i < 2 * meadow.max_lifetime; ++i) engine.tick();
+
+  std::vector<double> samples;
+  samples.reserve(ticks);
+  std::size_t events = 0;
+  for (int i = 0; i < ticks; ++i) {
+    const auto start = Clock::now();
+    events += engine.tick();
+    samples.push_back(nanoseconds(Clock::now() - start));
+  }
+  std::sort(samples.begin(), samples.end());
+  double total = 0;
+  for (double sample : samples) total += sample;
+  const double mean = total / samples.size();
+  const double p99 = samples[samples.size() * 99 / 100];
+
+  // Reading one zone, as the /zones/<id>/spawns route does
+  std::vector<Spawn> spawns;
+  const auto read_start = Clock::now();
+  for (std::size_t zone = 0; zone < zones; ++zone) {
+    engine.spawns(zone, spawns);
+  }
+  const double read_ns = nanoseconds(Clock::now() - read_start) / zones;
+
+  const SpawnEngineStats stats = engine.stats();
+  std::printf("%zu zones x %zu areas, %d ticks (built in %.1f ms)\n", zones,
+              meadow.areas.size(), ticks, build_ms);
+  std::printf("tick:   mean %10.1f us  p99 %10.1f us  %6.1f ns per zone\n",
+              mean / 1000, p99 / 1000, mean / zones);
+  std::printf("events: %10.1f per tick  %6.1f ns per event\n",
+              static_cast<double>(events) / ticks,
+              events ? total / events : 0.0);
+  std::printf("live:   %10zu spawns  %6.2f per zone\n", stats.live,
+              static_cast<double>(stats.live) / zones);
+  std::printf("memory: %10zu bytes  %6.1f bytes per zone\n", stats.bytes,
+              static_cast<double>(stats.bytes) / zones);
+  std::printf("read:   %10.1f ns per zone\n", read_ns);
+
+  // Species sampling in the largest area, alone in its zone and with all
+  // but its rarest species already out (every draw takes the fallback)
+  const std::vector<Encounter>& rows = meadow.areas.back().encounters;
+  const EncounterTable table(rows);
+  std::vector<std::uint16_t> crowded;
+  for (std::size_t i = 0; i + 1 < rows.size(); ++i) {
+    crowded.push_back(rows[i].species);
+  }
+  std::printf("draw:   %10.1f ns alone  %6.1f ns with %zu of %zu out\n",
+              draw_ns(table, {}), draw_ns(table, crowded), crowded.size(),
+              rows.size());
+  return 0;
+}
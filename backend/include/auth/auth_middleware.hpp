@@ -0,0 +1,63 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Crow middleware that requires a valid session token
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include <crow.h>
+
+#include "auth/session_store.hpp"
+#include "auth/session_token.hpp"
+#include "models/api_response.hpp"
+
+// AuthMiddleware checks the "Authorization: Bearer <token>" header of the
+// routes that opt in to it and rejects the request with 401 when the token
+// is missing, forged or expired, or its server-side session has ended
+// (logout or idle expiry). Both checks are done in memory, by TokenSigner
+// and SessionStore; no database lookup happens per request. A request that
+// passes also keeps its session from going idle.
+//
+// It is a local middleware: register it on the app, point it at the
+// shared TokenSigner and SessionStore, and list it on every route that
+// needs a session.
+//
+// Example usage:
+//   crow::App<AuthMiddleware> app;
+//   app.get_middleware<AuthMiddleware>().signer = &signer;
+//   app.get_middleware<AuthMiddleware>().sessions = &sessions;
+//   CROW_ROUTE(app, "/me").CROW_MIDDLEWARES(app, AuthMiddleware)(
+//       [&app](const crow::request& req) {
+//         const auto& session = app.get_context<AuthMiddleware>(req).claims;
+//         ...
+//       });
+struct AuthMiddleware : crow::ILocalMiddleware {
+  // Available to the route handler once the token has been verified
+  struct context {
+    SessionClaims claims;
+  };
+
+  // Must be set before the server starts
+  const TokenSigner* signer = nullptr;
+  SessionStore* sessions = nullptr;
+
+  void before_handle(crow::request& req, crow::response& res, context& ctx) {
+    constexpr std::string_view kScheme = "Bearer ";
+    const std::string& header = req.get_header_value("Authorization");
+
+    if (header.compare(0, kScheme.size(), kScheme) == 0) {
+      auto claims =
+          signer->verify(std::string_view(header).substr(kScheme.size()));
+      if (claims && sessions->touch(claims->session_id, claims->username)) {
+        ctx.claims = std::move(*claims);
+        return;
+      }
+    }
+
+    res = responses::kInvalidToken.ToResponse();
+    res.end();
+  }
+
+  void after_handle(crow::request&, crow::response&, context&) {}
+};
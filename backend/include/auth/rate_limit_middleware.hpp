@@ -0,0 +1,61 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Crow middleware that throttles clients per IP address and per username
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <crow.h>
+
+#include "utils/rate_limiter.hpp"
+
+// Limits of one route. Disabled buckets (rate zero) are skipped.
+struct RouteLimits {
+  BucketLimit per_ip;
+  BucketLimit per_username;  // Keyed by the "username" field of the body
+
+  // Reads RATE_LIMIT_<ROUTE>_IP_PER_MINUTE, RATE_LIMIT_<ROUTE>_IP_BURST,
+  // RATE_LIMIT_<ROUTE>_USER_PER_MINUTE and RATE_LIMIT_<ROUTE>_USER_BURST
+  // from the .env file, falling back to defaults.
+  static RouteLimits from_env(const std::string& route,
+                              const RouteLimits& defaults);
+};
+
+// RateLimitMiddleware answers 429 Too Many Requests, with a Retry-After
+// header, once a client has used up its token bucket. It runs before the
+// route handler, so a credential-stuffing burst is turned away before any
+// password hashing or database work happens.
+//
+// Each route has its own limits, set with limit(). Buckets live in a
+// fixed-size RateLimiter, so memory stays bounded however many addresses
+// and usernames are seen.
+//
+// Example usage:
+//   crow::App<RateLimitMiddleware> app;
+//   auto& rate_limit = app.get_middleware<RateLimitMiddleware>();
+//   rate_limit.configure(65536, false);
+//   rate_limit.limit("/login", RouteLimits{{0.5, 10}, {0.2, 5}});
+//   CROW_ROUTE(app, "/login").CROW_MIDDLEWARES(app, RateLimitMiddleware)(...)
+struct RateLimitMiddleware : crow::ILocalMiddleware {
+  struct context {};
+
+  // Allocates the bucket table. trust_forwarded takes the client address
+  // from X-Forwarded-For, for servers behind a reverse proxy. Must be
+  // called before the server starts.
+  void configure(std::size_t capacity, bool trust_forwarded);
+
+  // Sets the limits of the route with the given path
+  void limit(const std::string& path, RouteLimits limits);
+
+  RateLimiterStats stats() const;
+
+  void before_handle(crow::request& req, crow::response& res, context& ctx);
+  void after_handle(crow::request&, crow::response&, context&) {}
+
+ private:
+  std::unique_ptr<RateLimiter> limiter;
+  std::unordered_map<std::string, RouteLimits> routes;
+  bool trust_forwarded = false;
+};
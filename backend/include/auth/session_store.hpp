@@ -0,0 +1,142 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Sharded in-memory session store with timer-wheel expiry
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/timer_wheel.hpp"
+
+// A logged-in player as seen by the session store
+struct Session {
+  std::string username;
+  std::int64_t created_at;  // Unix time in seconds
+  std::int64_t expires_at;  // Unix time in seconds; moves on every touch
+  std::uint64_t zone_ticket;  // Of the session's latest zone entry; 0 if none
+};
+
+// Counters reported by SessionStore::stats(), for capacity planning
+struct SessionStoreStats {
+  std::size_t sessions;           // Live sessions
+  std::size_t shards;
+  std::size_t bytes;              // Estimated memory use of all shards
+  std::size_t fixed_bytes;        // Part of bytes that exists with no sessions
+  std::size_t bytes_per_session;  // Cost of one more session (0 when empty)
+  std::uint64_t created;
+  std::uint64_t expired;          // Removed by the timer wheel
+  std::uint64_t removed;          // Removed by logout
+};
+
+// SessionStore keeps server-side sessions for hundreds of thousands of
+// concurrent players. Sessions are spread over shards by a hash of their
+// id; each shard has its own reader/writer lock, so lookups on different
+// shards never contend and lookups on the same shard share the lock.
+//
+// Sessions expire after the idle timeout. Each shard keeps a TimerWheel of
+// deadlines, and a reaper thread advances every wheel once per second:
+// only the sessions that are due are visited, never the whole table.
+// touch() moves the deadline lazily (the wheel re-checks it when the old
+// deadline fires), so a busy session costs one store per request.
+//
+// stats() estimates the memory held per session (map node, strings, wheel
+// hook and bucket array) so the footprint can be planned from player
+// counts.
+//
+// Example usage:
+//   SessionStore sessions(64, std::chrono::seconds(3600));
+//   std::string id = sessions.create("ash");
+//   if (sessions.touch(id, "ash")) { ... }
+class SessionStore {
+ public:
+  // Starts the reaper thread. A shard count of zero is raised to one.
+  SessionStore(std::size_t shards, std::chrono::seconds idle_timeout);
+
+  // Stops the reaper thread
+  ~SessionStore();
+
+  SessionStore(const SessionStore&) = delete;
+  SessionStore& operator=(const SessionStore&) = delete;
+
+  // Creates a session for username and returns its random id (32 hex
+  // characters).
+  //
+  // Throws:
+  //   std::runtime_error: If no random id could be generated
+  std::string create(const std::string& username);
+
+  // Returns the session, or nothing if it does not exist or has expired
+  std::optional<Session> find(const std::string& id) const;
+
+  // Extends the session's idle timeout if it belongs to username. Returns
+  // false if there is no such session.
+  bool touch(const std::string& id, const std::string& username);
+
+  // Records the MovementEngine ticket of a zone entry made with the
+  // session, so ending the session can undo that entry and no other
+  void set_zone_ticket(const std::string& id, std::uint64_t ticket);
+
+  // Removes the session if it belongs to username.
+  //
+  // Returns:
+  //   std::optional<Session>: The removed session, or nothing if there was
+  //     no such session
+  std::optional<Session> remove(const std::string& id,
+                                const std::string& username);
+
+  SessionStoreStats stats() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // The TimerNode base links the entry into its shard's wheel
+  struct Entry : TimerNode {
+    const std::string* id;  // Key of this entry's map node
+    std::string username;
+    std::int64_t created_at;
+    // Tick; touch() moves only this, the wheel keeps the old one
+    std::atomic<std::uint64_t> idle_deadline;
+    std::atomic<std::uint64_t> zone_ticket{0};
+  };
+
+  struct Shard {
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    TimerWheel wheel;
+    std::size_t string_bytes = 0;  // Heap held by ids and usernames
+  };
+
+  Shard& shard_of(const std::string& id) const;
+
+  // Seconds since the store started; one wheel tick per second
+  std::uint64_t now_tick() const;
+  std::int64_t to_unix(std::uint64_t tick) const;
+
+  void reap_loop();
+
+  const std::uint64_t timeout_ticks;
+  const Clock::time_point started;
+  const std::int64_t started_unix;
+
+  std::vector<std::unique_ptr<Shard>> shards;
+
+  std::atomic<std::uint64_t> created{0};
+  std::atomic<std::uint64_t> expired{0};
+  std::atomic<std::uint64_t> removed{0};
+
+  std::mutex reaper_mutex;
+  std::condition_variable reaper_wake;
+  bool stopping = false;
+  std::thread reaper;
+};
@@ -0,0 +1,123 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Stateless HMAC-signed session tokens with a rotating key ring
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utils/env.hpp"
+
+// What a valid token proves about its bearer
+struct SessionClaims {
+  std::string username;
+  std::string session_id;   // Server-side session the token belongs to
+  std::int64_t expires_at;  // Unix time in seconds
+};
+
+// A token handed to the client by /login
+struct IssuedToken {
+  std::string token;
+  std::int64_t expires_at;  // Unix time in seconds
+};
+
+// One HMAC secret. The id travels in every token so the verifier knows
+// which secret signed it.
+struct SigningKey {
+  std::uint32_t id;
+  std::string secret;
+};
+
+// Immutable set of signing keys. The first key signs new tokens; the rest
+// are older keys that still verify the tokens they signed, so a rotation
+// does not log every player out.
+class KeyRing {
+ public:
+  KeyRing(std::vector<SigningKey> keys, std::uint64_t env_version)
+      : keys(std::move(keys)), env_version(env_version) {}
+
+  const SigningKey& active() const { return keys.front(); }
+
+  // Returns the key with the given id, or nullptr if it was retired
+  const SigningKey* find(std::uint32_t id) const {
+    for (const SigningKey& key : keys) {
+      if (key.id == id) return &key;
+    }
+    return nullptr;
+  }
+
+  const std::vector<SigningKey>& all() const { return keys; }
+
+  // EnvSnapshot version the ring was built from
+  std::uint64_t version() const { return env_version; }
+
+ private:
+  const std::vector<SigningKey> keys;
+  const std::uint64_t env_version;
+};
+
+// TokenSigner issues and verifies compact session tokens:
+//
+//   base64url(payload) "." base64url(HMAC-SHA256(secret, payload))
+//
+// where the payload is a format byte, the 32-bit key id, the 64-bit expiry,
+// the session id (length-prefixed) and the username. Verification is one
+// HMAC over a few dozen bytes and needs no database lookup. The session id
+// ties the token to a SessionStore entry, so ending that session (logout,
+// idle expiry) revokes the token; AuthMiddleware checks it.
+//
+// Keys come from SESSION_SIGNING_KEYS in the .env file, as a comma
+// separated list of "<id>:<secret>" with the signing key first:
+//   SESSION_SIGNING_KEYS=3:new-secret,2:previous-secret
+// To rotate, prepend a key with a new id and drop the oldest one after the
+// token lifetime has passed. With ENV_WATCH=1 the change applies without a
+// restart. When no key is configured a random one is generated at startup,
+// so tokens do not survive a restart.
+//
+// Thread-safe; one instance is shared by every handler.
+class TokenSigner {
+ public:
+  // Reads the key ring and SESSION_TOKEN_TTL_SECONDS (default 3600).
+  //
+  // Throws:
+  //   std::runtime_error: If SESSION_SIGNING_KEYS is malformed
+  TokenSigner();
+
+  TokenSigner(const TokenSigner&) = delete;
+  TokenSigner& operator=(const TokenSigner&) = delete;
+
+  // Signs a token for username's session session_id with the active key
+  //
+  // Throws:
+  //   std::runtime_error: If username or session_id is too long
+  IssuedToken issue(const std::string& username,
+                    const std::string& session_id) const;
+
+  // Returns the claims of a well-formed, correctly signed, unexpired
+  // token, or nothing otherwise.
+  std::optional<SessionClaims> verify(std::string_view token) const;
+
+  std::chrono::seconds ttl() const { return lifetime; }
+
+ private:
+  // Current key ring, rebuilt when the .env file has changed
+  const KeyRing& ring() const;
+
+  const std::chrono::seconds lifetime;
+
+  // Used when SESSION_SIGNING_KEYS is not set
+  const SigningKey generated_key;
+
+  // Published rings; replaced rings stay alive so a reference returned by
+  // ring() is never left dangling (see EnvLoader for the same scheme)
+  mutable std::atomic<const KeyRing*> current{nullptr};
+  mutable std::mutex publish_mutex;
+  mutable std::vector<std::unique_ptr<const KeyRing>> rings;
+};
@@ -365,6 +365,20 @@ namespace crow
             return concurrency_;
         }
 
+        /// \brief Listen with SO_REUSEPORT so several processes can share the port (ignored where unsupported)
+        self_t& reuse_port(bool enabled)
+        {
+            reuse_port_ = enabled;
+            return *this;
+        }
+
+        /// \brief Run a function on each I/O worker thread, with its index, before it serves any connection
+        self_t& on_io_thread_start(std::function<void(std::uint16_t)> f)
+        {
+            io_thread_start_function_ = std::move(f);
+            return *this;
+        }
+
         /// \brief Set the server's log level
         ///
         /// Possible values are:
@@ -502,8 +516,9 @@ namespace crow
 #ifdef CROW_ENABLE_SSL
             if (ssl_used_)
             {
-                ssl_server_ = std::move(std::unique_ptr<ssl_server_t>(new ssl_server_t(this, bindaddr_, port_, server_name_, &middlewares_, concurrency_, timeout_, &ssl_context_)));
+                ssl_server_ = std::move(std::unique_ptr<ssl_server_t>(new ssl_server_t(this, bindaddr_, port_, server_name_, &middlewares_, concurrency_, timeout_, &ssl_context_, reuse_port_)));
                 ssl_server_->set_tick_function(tick_interval_, tick_function_);
+                ssl_server_->set_io_thread_start_function(io_thread_start_function_);
                 ssl_server_->signal_clear();
                 for (auto snum : signals_)
                 {
@@ -515,8 +530,9 @@ namespace crow
             else
 #endif
             {
-                server_ = std::move(std::unique_ptr<server_t>(new server_t(this, bindaddr_, port_, server_name_, &middlewares_, concurrency_, timeout_, nullptr)));
+                server_ = std::move(std::unique_ptr<server_t>(new server_t(this, bindaddr_, port_, server_name_, &middlewares_, concurrency_, timeout_, nullptr, reuse_port_)));
                 server_->set_tick_function(tick_interval_, tick_function_);
+                server_->set_io_thread_start_function(io_thread_start_function_);
                 for (auto snum : signals_)
                 {
                     server_->signal_add(snum);
@@ -559,6 +575,21 @@ namespace crow
             }
         }
 
+        /// \brief Stop accepting new connections while open ones are still served, e.g. to drain them before \ref stop()
+        void stop_accepting()
+        {
+#ifdef CROW_ENABLE_SSL
+            if (ssl_used_)
+            {
+                if (ssl_server_) { ssl_server_->stop_accepting(); }
+            }
+            else
+#endif
+            {
+                if (server_) { server_->stop_accepting(); }
+            }
+        }
+
         void add_websocket(crow::websocket::connection* conn)
         {
             websockets_.push_back(conn);
@@ -735,6 +766,7 @@ namespace crow
         uint64_t max_payload_{UINT64_MAX};
         std::string server_name_ = std::string("Crow/") + VERSION;
         std::string bindaddr_ = "0.0.0.0";
+        bool reuse_port_ = false;
         size_t res_stream_threshold_ = 1048576;
         Router router_;
         bool static_routes_added_{false};
@@ -746,6 +778,7 @@ namespace crow
 
         std::chrono::milliseconds tick_interval_;
         std::function<void()> tick_function_;
+        std::function<void(std::uint16_t)> io_thread_start_function_;
 
         std::tuple<Middlewares...> middlewares_;
 
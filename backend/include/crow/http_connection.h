@@ -231,6 +231,13 @@ namespace crow
                   decltype(ctx_),
                   decltype(*middlewares_)>({}, *middlewares_, ctx_, req_, res);
             }
+
+            // A handler or middleware may ask for the connection to be closed after this response
+            if (res.get_header_value("connection") == "close")
+            {
+                close_connection_ = true;
+                add_keep_alive_ = false;
+            }
 #ifdef CROW_ENABLE_COMPRESSION
             if (handler_->compression_used())
             {
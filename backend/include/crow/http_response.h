@@ -247,7 +247,12 @@ namespace crow
                 }
                 if (complete_request_handler_)
                 {
-                    complete_request_handler_();
+                    // Completing the request clears complete_request_handler_, and
+                    // for an asynchronous response its captured shared_ptr may be
+                    // the last owner of the connection. Invoke a copy so the
+                    // connection (and this response) outlive the call.
+                    auto handler = complete_request_handler_;
+                    handler();
                     manual_length_header = false;
                     skip_body = false;
                 }
@@ -42,8 +42,8 @@ namespace crow // NOTE: Already documented in "crow/app.h"
     class Server
     {
     public:
-        Server(Handler* handler, std::string bindaddr, uint16_t port, std::string server_name = std::string("Crow/") + VERSION, std::tuple<Middlewares...>* middlewares = nullptr, uint16_t concurrency = 1, uint8_t timeout = 5, typename Adaptor::context* adaptor_ctx = nullptr):
-          acceptor_(io_service_, tcp::endpoint(asio::ip::address::from_string(bindaddr), port)),
+        Server(Handler* handler, std::string bindaddr, uint16_t port, std::string server_name = std::string("Crow/") + VERSION, std::tuple<Middlewares...>* middlewares = nullptr, uint16_t concurrency = 1, uint8_t timeout = 5, typename Adaptor::context* adaptor_ctx = nullptr, bool reuse_port = false):
+          acceptor_(io_service_),
           signals_(io_service_),
           tick_timer_(io_service_),
           handler_(handler),
@@ -55,7 +55,21 @@ namespace crow // NOTE: Already documented in "crow/app.h"
           task_queue_length_pool_(concurrency_ - 1),
           middlewares_(middlewares),
           adaptor_ctx_(adaptor_ctx)
-        {}
+        {
+            tcp::endpoint endpoint(asio::ip::address::from_string(bindaddr), port);
+            acceptor_.open(endpoint.protocol());
+            acceptor_.set_option(tcp::acceptor::reuse_address(true));
+#ifdef SO_REUSEPORT
+            // Lets several processes listen on the same port; the kernel
+            // spreads incoming connections across them
+            if (reuse_port)
+                acceptor_.set_option(asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true));
+#else
+            (void)reuse_port;
+#endif
+            acceptor_.bind(endpoint);
+            acceptor_.listen();
+        }
 
         void set_tick_function(std::chrono::milliseconds d, std::function<void()> f)
         {
@@ -63,6 +77,12 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             tick_function_ = f;
         }
 
+        /// Called on each I/O worker thread, with its index, before it starts serving connections
+        void set_io_thread_start_function(std::function<void(uint16_t)> f)
+        {
+            io_thread_start_function_ = f;
+        }
+
         void on_tick()
         {
             tick_function_();
@@ -121,6 +141,9 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                         task_timer_pool_[i] = &task_timer;
                         task_queue_length_pool_[i] = 0;
 
+                        if (io_thread_start_function_)
+                            io_thread_start_function_(i);
+
                         init_count++;
                         while (1)
                         {
@@ -192,6 +215,16 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             io_service_.stop(); // Close main io_service
         }
 
+        /// Stop taking new connections but keep serving the open ones
+        void stop_accepting()
+        {
+            io_service_.post([this] {
+                shutting_down_ = true;
+                error_code ec;
+                acceptor_.close(ec);
+            });
+        }
+
         /// Wait until the server has properly started
         void wait_for_start()
         {
@@ -292,6 +325,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
 
         std::chrono::milliseconds tick_interval_;
         std::function<void()> tick_function_;
+        std::function<void(uint16_t)> io_thread_start_function_;
 
         std::tuple<Middlewares...>* middlewares_;
 
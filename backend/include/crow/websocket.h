@@ -1,5 +1,6 @@
 #pragma once
 #include <array>
+#include <atomic>
 #include "crow/logging.h"
 #include "crow/socket_adaptors.h"
 #include "crow/http_request.h"
@@ -44,6 +45,10 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             virtual std::string get_remote_ip() = 0;
             virtual ~connection() = default;
 
+            /// Bytes passed to send_* (plus frame headers) that have not been
+            /// written to the socket yet. Safe to call from any thread.
+            virtual std::size_t buffered_amount() const { return 0; }
+
             void userdata(void* u) { userdata_ = u; }
             void* userdata() { return userdata_; }
 
@@ -224,6 +229,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                             close_handler_(*this, msg);
                     }
                     auto header = build_header(0x8, msg.size());
+                    buffered_bytes_ += header.size() + msg.size();
                     write_buffers_.emplace_back(std::move(header));
                     write_buffers_.emplace_back(msg);
                     do_write();
@@ -235,6 +241,11 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 return adaptor_.remote_endpoint().address().to_string();
             }
 
+            std::size_t buffered_amount() const override
+            {
+                return buffered_bytes_.load(std::memory_order_relaxed);
+            }
+
             void set_max_payload_size(uint64_t payload)
             {
                 max_payload_bytes_ = payload;
@@ -276,6 +287,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                   "Upgrade: websocket\r\n"
                   "Connection: Upgrade\r\n"
                   "Sec-WebSocket-Accept: ";
+                buffered_bytes_ += header.size() + hello.size() + 2 * crlf.size();
                 write_buffers_.emplace_back(header);
                 write_buffers_.emplace_back(std::move(hello));
                 write_buffers_.emplace_back(crlf);
@@ -655,9 +667,10 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                     auto watch = std::weak_ptr<void>{anchor_};
                     asio::async_write(
                       adaptor_.socket(), buffers,
-                      [&, watch](const error_code& ec, std::size_t /*bytes_transferred*/) {
+                      [&, watch](const error_code& ec, std::size_t bytes_transferred) {
                           if (!ec && !close_connection_)
                           {
+                              buffered_bytes_ -= bytes_transferred;
                               sending_buffers_.clear();
                               if (!write_buffers_.empty())
                                   do_write();
@@ -705,6 +718,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             void send_data_impl(SendMessageType* s)
             {
                 auto header = build_header(s->opcode, s->payload.size());
+                buffered_bytes_ += header.size();
                 write_buffers_.emplace_back(std::move(header));
                 write_buffers_.emplace_back(std::move(s->payload));
                 do_write();
@@ -712,6 +726,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
 
             void send_data(int opcode, std::string&& msg)
             {
+                buffered_bytes_ += msg.size();
                 SendMessageType event_arg{
                   std::move(msg),
                   this,
@@ -726,6 +741,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
 
             std::vector<std::string> sending_buffers_;
             std::vector<std::string> write_buffers_;
+            std::atomic<std::size_t> buffered_bytes_{0};
 
             std::array<char, 4096> buffer_;
             bool is_binary_;
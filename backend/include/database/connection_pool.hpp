@@ -0,0 +1,202 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Bounded pool of MySQL connections shared by the Crow worker threads
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <cppconn/exception.h>
+#include <cppconn/prepared_statement.h>
+#include <mysql_connection.h>
+
+#include "database/db_config.hpp"
+#include "database/storage_backend.hpp"
+#include "utils/trace.hpp"
+
+// A pooled MySQL connection together with the prepared statements created
+// on it. Statements are keyed by their SQL text and live as long as the
+// connection, so each query is parsed by the server once per connection
+// instead of once per request.
+class PooledConnection {
+ public:
+  PooledConnection(std::unique_ptr<sql::Connection> conn,
+                   std::atomic<std::size_t>* hits,
+                   std::atomic<std::size_t>* misses);
+
+  sql::Connection* operator->() const { return conn.get(); }
+  sql::Connection& operator*() const { return *conn; }
+
+  // Returns the cached statement for query, preparing it on first use.
+  // The statement is owned by the cache; callers bind parameters and
+  // execute it but must not delete it.
+  sql::PreparedStatement& prepare(const std::string& query);
+
+  // Runs fn with the cached statement for query. If the server dropped the
+  // statement because the connector reconnected behind our back, the cache
+  // is cleared, the statement is re-prepared and fn runs once more.
+  //
+  // Throws:
+  //   sql::SQLException: Any other error, or a second failure
+  template <typename Fn>
+  auto execute(const std::string& query, Fn&& fn)
+      -> decltype(fn(std::declval<sql::PreparedStatement&>())) {
+    try {
+      sql::PreparedStatement& stmt = prepare(query);
+      StageTimer stage("db.execute");
+      return fn(stmt);
+    } catch (sql::SQLException& e) {
+      if (!is_stale_statement_error(e)) throw;
+      clear_statements();
+      if (!conn->isValid()) conn->reconnect();
+      sql::PreparedStatement& stmt = prepare(query);
+      StageTimer stage("db.execute");
+      return fn(stmt);
+    }
+  }
+
+  // Drops every cached statement, e.g. after a reconnect.
+  void clear_statements() { statements.clear(); }
+
+ private:
+  // Errors raised before the statement ran that mean its server-side
+  // handle is gone: the server went away (2006) or no longer knows the
+  // statement id (1243). Both are safe to retry.
+  static bool is_stale_statement_error(const sql::SQLException& e) {
+    return e.getErrorCode() == 2006 || e.getErrorCode() == 1243;
+  }
+
+  std::unique_ptr<sql::Connection> conn;
+  // Declared after conn so statements are closed before their connection
+  std::unordered_map<std::string, std::unique_ptr<sql::PreparedStatement>>
+      statements;
+  std::atomic<std::size_t>* hits;
+  std::atomic<std::size_t>* misses;
+};
+
+// ConnectionPool hands out MySQL connections to one thread at a time.
+// sql::Connection is not safe to share between threads, so every
+// DatabaseManager operation checks a connection out for its duration and
+// returns it afterwards.
+//
+// warm_up() opens config.pool_min_size connections, the pool grows lazily up
+// to config.pool_max_size, and closes surplus connections that stay idle
+// longer than config.pool_idle_timeout_ms. When every connection is busy,
+// acquire() blocks for at most config.pool_wait_timeout_ms.
+//
+// Example usage:
+//   ConnectionPool pool(config);
+//   pool.warm_up();
+//   auto conn = pool.acquire();
+//   std::unique_ptr<sql::Statement> stmt(conn->createStatement());
+//   conn.execute("SELECT ...", [](sql::PreparedStatement& stmt) { ... });
+class ConnectionPool {
+ public:
+  // RAII handle to a checked-out connection. The connection goes back to
+  // the pool when the lease is destroyed, unless it was marked broken.
+  class Lease {
+   public:
+    Lease(ConnectionPool* pool, std::unique_ptr<PooledConnection> conn);
+    Lease(Lease&& other) noexcept;
+    Lease& operator=(Lease&&) = delete;
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+    ~Lease();
+
+    sql::Connection* operator->() const { return &**conn; }
+    sql::Connection& operator*() const { return **conn; }
+
+    // See PooledConnection::prepare
+    sql::PreparedStatement& prepare(const std::string& query) {
+      return conn->prepare(query);
+    }
+
+    // See PooledConnection::execute
+    template <typename Fn>
+    auto execute(const std::string& query, Fn&& fn) {
+      return conn->execute(query, std::forward<Fn>(fn));
+    }
+
+    // Marks the connection as unusable so it is closed instead of being
+    // returned to the pool (e.g. after a lost-connection error).
+    void mark_broken() { broken = true; }
+
+   private:
+    ConnectionPool* pool;
+    std::unique_ptr<PooledConnection> conn;
+    bool broken = false;
+  };
+
+  // Reads the pool limits from config; no connection is opened yet.
+  explicit ConnectionPool(const DBConfig& config);
+
+  ConnectionPool(const ConnectionPool&) = delete;
+  ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+  // Opens connections until the pool holds its minimum size, so the first
+  // requests do not pay for the handshake.
+  //
+  // Throws:
+  //   sql::SQLException: If a connection cannot be established
+  void warm_up();
+
+  // Checks out a connection, opening a new one if the pool is below its
+  // maximum size.
+  //
+  // Throws:
+  //   PoolTimeoutError: If no connection is available within the wait timeout
+  //   sql::SQLException: If a new connection cannot be established
+  Lease acquire();
+
+  PoolStats stats() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct IdleConnection {
+    std::unique_ptr<PooledConnection> conn;
+    Clock::time_point idle_since;
+  };
+
+  // Opens a new connection with the configured credentials and schema.
+  std::unique_ptr<PooledConnection> open_connection();
+
+  // Called by Lease to give a connection back.
+  void release(std::unique_ptr<PooledConnection> conn, bool broken);
+
+  // Closes idle connections above the minimum size that exceeded the idle
+  // timeout. Must be called with mutex held; returns the connections to be
+  // destroyed outside the lock.
+  std::vector<std::unique_ptr<PooledConnection>> evict_idle_locked(
+      Clock::time_point now);
+
+  const DBConfig& config;
+  const std::size_t min_size;
+  const std::size_t max_size;
+  const std::chrono::milliseconds idle_timeout;
+  const std::chrono::milliseconds wait_timeout;
+
+  mutable std::mutex mutex;
+  std::condition_variable available;
+
+  // Idle connections ordered by the time they were returned; the back is the
+  // most recently used one, so hot connections are reused first and cold
+  // ones age out at the front.
+  std::vector<IdleConnection> idle;
+  std::size_t open = 0;
+  std::size_t waiting = 0;
+  std::size_t timeouts = 0;
+  std::size_t evictions = 0;
+
+  // Shared by every PooledConnection; updated without taking mutex
+  std::atomic<std::size_t> statement_cache_hits{0};
+  std::atomic<std::size_t> statement_cache_misses{0};
+};
@@ -1,15 +1,34 @@
 #pragma once
 
 #include <memory>           // For std::unique_ptr
+#include <optional>
+#include <stdexcept>
+#include <cppconn/exception.h>
 #include <mysql_connection.h>
 
+#include "database/connection_pool.hpp"
 #include "database/db_config.hpp"
+#include "database/storage_backend.hpp"
+#include "database/user_index.hpp"
 #include "models/user.hpp"
 
+class SignupBatcher;
+
+// Parameterized insert shared by create_user and the signup batcher
+inline constexpr char kInsertUserQuery[] =
+    "INSERT INTO users (email, username, password) "
+    "VALUES (?, ?, ?)";
+
+// Translates a failed user INSERT into the error reported to the client:
+// which unique constraint a duplicate entry (MySQL error 1062) violated,
+// or a generic database error otherwise.
+std::runtime_error user_insert_error(const sql::SQLException& e);
+
 // DatabaseManager is responsible for handling all database operations
 // including user creation, connection management, and error handling.
-// This class serves as an abstraction layer between the application
-// and the underlying MySQL database.
+// It is the MySQL implementation of StorageBackend and serves as an
+// abstraction layer between the application and the underlying MySQL
+// database.
 //
 // Example usage:
 //   DatabaseManager db;
@@ -17,18 +36,24 @@
 //   if (db.create_user(new_user)) {
 //      User created successfully
 //   }
-class DatabaseManager {
+class DatabaseManager : public StorageBackend {
  public:
-  // Constructor initializes the database connection and ensures
+  // Constructor initializes the database connection pool and ensures
   // the required database structure exists. It will:
-  // 1. Establish connection to MySQL using the configuration
-  // 2. Create the users table if it doesn't exist
-  // 3. Throw an exception if connection fails
+  // 1. Open the pool's initial MySQL connections using the configuration
+  // 2. Apply pending schema migrations (see schema_migrations.hpp)
+  // 3. Load existing usernames and emails into the duplicate index
+  // 4. Start the signup batcher if DB_SIGNUP_BATCHING is enabled
+  // 5. Throw an exception if connection fails
   DatabaseManager();
 
+  // Flushes pending batched signups before the pool closes
+  ~DatabaseManager() override;
+
   // Creates a new user in the database.
   // Thread-safe method that handles user creation with proper
-  // error checking and constraint validation.
+  // error checking and constraint validation. With batching enabled the
+  // call blocks until the user's batch has committed.
   //
   // Args:
   //   user: A User object containing the user information to store
@@ -38,18 +63,45 @@ class DatabaseManager {
   //
   // Throws:
   //   std::runtime_error: If user creation fails (e.g., duplicate email/username)
+  //   PoolTimeoutError: If no database connection frees up in time
   //   sql::SQLException: If there's a database connection error
-  bool create_user(const User& user);
+  bool create_user(const User& user) override;
 
-  bool login_user(const User& user);
+  // Answers from the duplicate index; accepts everything when the index
+  // is disabled
+  void check_duplicate(const User& user) override;
 
- private:
-  // Manages the lifetime of the database connection
-  // Using unique_ptr ensures proper resource cleanup
-  std::unique_ptr<sql::Connection> conn;
+  // Looks up a user's stored username and password hash. Thread-safe.
+  //
+  // Throws:
+  //   PoolTimeoutError: If no database connection frees up in time
+  //   std::runtime_error: If the query fails
+  std::optional<StoredCredentials> find_credentials(
+      const std::string& username) override;
 
+  // Current connection pool and prepared statement cache counters
+  PoolStats pool_stats() const override { return pool.stats(); }
+
+  // Duplicate index counters; all zero when the index is disabled
+  UserIndexStats user_index_stats() const override {
+    return user_index ? user_index->stats() : UserIndexStats{0, 0, 0};
+  }
+
+ private:
   // Database configuration parameters
   // Contains connection details like host, user, password, and database name
+  // Declared before the pool, which reads it during construction
   DBConfig config;
+
+  // Connections are checked out per operation so Crow's worker threads
+  // never share a sql::Connection
+  ConnectionPool pool;
+
+  // Usernames and emails known to be taken; null when DB_USER_INDEX=0
+  std::unique_ptr<UserIndex> user_index;
+
+  // Group-commit writer for create_user; null unless batching is enabled.
+  // Declared after the pool so it is destroyed (and flushed) first.
+  std::unique_ptr<SignupBatcher> signup_batcher;
 };
 
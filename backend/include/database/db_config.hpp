@@ -3,6 +3,7 @@
 
 #pragma once
 #include "utils/env.hpp"
+#include <cstddef>
 #include <string>
 
 struct DBConfig {
@@ -10,4 +11,36 @@ struct DBConfig {
     const std::string user = EnvLoader::getEnvVariable("DB_USER", "");
     const std::string password = EnvLoader::getEnvVariable("DB_PASSWORD", "");
     const std::string database = EnvLoader::getEnvVariable("DB_NAME", "");
-};
\ No newline at end of file
+
+    // Connection pool sizing. The pool opens pool_min_size connections at
+    // startup and grows on demand up to pool_max_size, which should be at
+    // least the number of Crow worker threads.
+    const std::size_t pool_min_size =
+        std::stoul(EnvLoader::getEnvVariable("DB_POOL_MIN_SIZE", "2"));
+    const std::size_t pool_max_size =
+        std::stoul(EnvLoader::getEnvVariable("DB_POOL_MAX_SIZE", "16"));
+
+    // Connections above pool_min_size that sit unused for longer than this
+    // are closed.
+    const std::size_t pool_idle_timeout_ms =
+        std::stoul(EnvLoader::getEnvVariable("DB_POOL_IDLE_TIMEOUT_MS", "60000"));
+
+    // How long a request waits for a free connection before giving up.
+    const std::size_t pool_wait_timeout_ms =
+        std::stoul(EnvLoader::getEnvVariable("DB_POOL_WAIT_TIMEOUT_MS", "2000"));
+
+    // Optional group commit for signups. When enabled, inserts arriving
+    // within signup_batch_window_ms of each other (up to
+    // signup_batch_max_size rows) share a single transaction.
+    const bool signup_batching =
+        EnvLoader::getEnvVariable("DB_SIGNUP_BATCHING", "0") == "1";
+    const std::size_t signup_batch_window_ms =
+        std::stoul(EnvLoader::getEnvVariable("DB_SIGNUP_BATCH_WINDOW_MS", "5"));
+    const std::size_t signup_batch_max_size =
+        std::stoul(EnvLoader::getEnvVariable("DB_SIGNUP_BATCH_MAX_SIZE", "64"));
+
+    // Keep taken usernames and emails in memory to reject duplicate
+    // signups without a database round trip.
+    const bool user_index =
+        EnvLoader::getEnvVariable("DB_USER_INDEX", "1") == "1";
+};
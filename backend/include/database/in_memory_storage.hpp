@@ -0,0 +1,54 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Thread-safe in-memory storage backend for load testing without MySQL
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "database/storage_backend.hpp"
+#include "models/user.hpp"
+
+// InMemoryStorage implements StorageBackend with hash tables in process
+// memory. It enforces the same unique username/email rules and error
+// messages as the MySQL users table, so the REST stack behaves the same
+// while it is benchmarked or profiled on a machine without a database.
+// Nothing is persisted across restarts.
+//
+// Like the table's default collation, usernames and emails are compared
+// case-insensitively: both are stored under fold_case() keys.
+//
+// Usernames and emails live in separate sharded tables. create_user locks
+// the username shard and the email shard together, so the two uniqueness
+// checks and the insert are atomic, while signups for unrelated names run
+// in parallel.
+class InMemoryStorage : public StorageBackend {
+ public:
+  bool create_user(const User& user) override;
+  void check_duplicate(const User& user) override;
+  std::optional<StoredCredentials> find_credentials(
+      const std::string& username) override;
+
+ private:
+  static constexpr std::size_t kShardCount = 32;
+
+  struct UserShard {
+    mutable std::shared_mutex mutex;
+    // Folded username -> username as signed up and password hash
+    std::unordered_map<std::string, StoredCredentials> passwords;
+  };
+
+  struct EmailShard {
+    std::shared_mutex mutex;
+    std::unordered_set<std::string> emails;  // Folded
+  };
+
+  static std::size_t shard_of(const std::string& key);
+
+  std::array<UserShard, kShardCount> users;
+  std::array<EmailShard, kShardCount> emails;
+};
@@ -0,0 +1,33 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Versioned schema migrations for the MySQL backend
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <mysql_connection.h>
+
+// A numbered schema change. Statements run in order and must be idempotent
+// (CREATE TABLE IF NOT EXISTS, ...): MySQL commits DDL implicitly, so a
+// migration interrupted half way is simply run again on the next start.
+struct Migration {
+  int version;
+  std::string description;
+  std::vector<std::string> statements;
+};
+
+// Every migration the backend knows about, in ascending version order.
+// To change the schema, append a new entry with the next version number;
+// never edit or reorder entries that have already shipped.
+const std::vector<Migration>& schema_migrations();
+
+// Brings the connected schema up to the latest version and returns it.
+//
+// On an up-to-date database this costs a single query against the
+// schema_version table. Pending migrations are applied under a MySQL named
+// lock, so servers starting at the same time do not race each other.
+//
+// Throws:
+//   sql::SQLException: If a migration or the version bookkeeping fails
+int migrate_schema(sql::Connection& conn);
@@ -0,0 +1,103 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Storage interface shared by the MySQL and in-memory backends
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#include "database/user_index.hpp"
+#include "models/user.hpp"
+
+// Thrown when the backend has no capacity left for the request, e.g. no
+// pooled connection became available within the wait timeout. Handlers map
+// it to 503 instead of treating it like a constraint violation.
+class PoolTimeoutError : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+// Snapshot of the connection pool counters, used for logging and capacity
+// planning. Backends without a pool report zeros.
+struct PoolStats {
+  std::size_t open;         // Connections currently open (idle + in use)
+  std::size_t idle;         // Connections waiting in the pool
+  std::size_t waiting;      // Threads blocked in acquire()
+  std::size_t timeouts;     // acquire() calls that hit the wait timeout
+  std::size_t evictions;    // Idle connections closed by the pool
+  std::size_t statement_cache_hits;    // Prepared statements reused
+  std::size_t statement_cache_misses;  // Statements prepared on the server
+};
+
+// A user's login record as stored
+struct StoredCredentials {
+  std::string username;       // As stored, which may differ in case from
+                              // the name it was looked up by
+  std::string password_hash;
+};
+
+// StorageBackend is the persistence interface used by the REST handlers.
+// DatabaseManager implements it on top of MySQL; InMemoryStorage keeps
+// everything in process so the server can be load-tested and profiled
+// without a database. Every method must be safe to call from several
+// threads at once.
+//
+// Example usage:
+//   auto db = make_storage_backend();
+//   db->create_user(User{"username", "email@example.com", password_hash});
+class StorageBackend {
+ public:
+  virtual ~StorageBackend() = default;
+
+  // Stores a new user. user.password must already be hashed; backends
+  // store it as given.
+  //
+  // Returns:
+  //   bool: true if user was created successfully
+  //
+  // Throws:
+  //   std::runtime_error: If the username or email is taken ("Username is
+  //     already taken" / "Email is already registered") or storage fails
+  //   PoolTimeoutError: If the backend is out of capacity
+  virtual bool create_user(const User& user) = 0;
+
+  // Rejects a signup the backend already knows to be a duplicate, from
+  // memory and without a storage round trip, so /signup can refuse it
+  // before paying for the password hash. Passing is not a promise:
+  // create_user still makes the final check. Backends without an
+  // in-memory view accept everything.
+  //
+  // Throws:
+  //   std::runtime_error: With create_user's message if the username or
+  //     email is known to be taken
+  virtual void check_duplicate(const User&) {}
+
+  // Returns the stored username and password hash of username, or nothing
+  // if there is no such user. Usernames match case-insensitively, as in
+  // the users table, so callers should key sessions by the stored name.
+  // Credentials are checked by the caller (PasswordHasher) so the slow
+  // comparison stays off the storage threads.
+  //
+  // Throws:
+  //   std::runtime_error: If storage fails
+  //   PoolTimeoutError: If the backend is out of capacity
+  virtual std::optional<StoredCredentials> find_credentials(
+      const std::string& username) = 0;
+
+  // Connection pool counters; zeros for backends without a pool
+  virtual PoolStats pool_stats() const { return {}; }
+
+  // Duplicate index counters; zeros for backends without an index
+  virtual UserIndexStats user_index_stats() const { return {}; }
+};
+
+// Creates the backend selected by STORAGE_BACKEND in the .env file:
+// "mysql" (the default when built with MySQL support) or "memory".
+//
+// Throws:
+//   std::runtime_error: If the backend is unknown or not compiled in
+//   sql::SQLException: If the MySQL backend cannot connect
+std::unique_ptr<StorageBackend> make_storage_backend();
@@ -0,0 +1,74 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// In-process index of taken usernames and emails
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_set>
+
+// Snapshot of the index size and how often it saved a database round trip.
+struct UserIndexStats {
+  std::size_t usernames;  // Usernames currently indexed
+  std::size_t emails;     // Emails currently indexed
+  std::size_t rejected;   // Signups rejected without touching MySQL
+};
+
+// UserIndex remembers every username and email known to be stored in the
+// users table, so an obvious duplicate signup can be answered with the
+// usual 409 message without paying for an INSERT that fails with 1062.
+//
+// Values are matched exactly. Any exact match is also a duplicate under
+// the column's collation, so the index never rejects a signup MySQL would
+// accept; near matches ("Ash" vs "ash") still go to the database, which
+// stays the source of truth. Users are never deleted by this backend, so
+// entries are never removed; a row deleted out of band would keep being
+// reported as taken until restart.
+//
+// Each set is split into shards with their own reader/writer lock so
+// concurrent signups on different names rarely contend.
+class UserIndex {
+ public:
+  void add(const std::string& username, const std::string& email);
+
+  bool has_username(const std::string& username) const;
+  bool has_email(const std::string& email) const;
+
+  // Counts a signup answered from the index
+  void record_rejection() { rejected.fetch_add(1, std::memory_order_relaxed); }
+
+  UserIndexStats stats() const;
+
+ private:
+  static constexpr std::size_t kShardCount = 16;
+
+  class ShardedSet {
+   public:
+    void insert(const std::string& value);
+    bool contains(const std::string& value) const;
+    std::size_t size() const;
+
+   private:
+    struct Shard {
+      mutable std::shared_mutex mutex;
+      std::unordered_set<std::string> values;
+    };
+
+    Shard& shard_for(const std::string& value) {
+      return shards[std::hash<std::string>{}(value) % kShardCount];
+    }
+    const Shard& shard_for(const std::string& value) const {
+      return shards[std::hash<std::string>{}(value) % kShardCount];
+    }
+
+    std::array<Shard, kShardCount> shards;
+  };
+
+  ShardedSet usernames;
+  ShardedSet emails;
+  std::atomic<std::size_t> rejected{0};
+};
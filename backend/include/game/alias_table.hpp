@@ -0,0 +1,50 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Walker alias tables for constant-time weighted sampling
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "game/random.hpp"
+
+// AliasTable draws index i with probability weights[i] / sum(weights) in
+// constant time, however many weights there are: one uniform column, then
+// one uniform compare against the column's threshold picks either the
+// column itself or its alias.
+//
+// It is built with Vose's method in integer arithmetic. Every column
+// holds exactly the total weight, so the probabilities are exact, not
+// rounded to floating point.
+//
+// Example usage:
+//   AliasTable table({45, 40, 10, 5});
+//   const std::uint32_t index = table.sample(rng);
+class AliasTable {
+ public:
+  // Throws:
+  //   std::invalid_argument: If weights is empty, has more than 2^16
+  //     entries, or sums to zero or to 2^32 or more
+  explicit AliasTable(const std::vector<std::uint32_t>& weights);
+
+  std::uint32_t sample(Random& rng) const {
+    const std::uint32_t column =
+        rng.below(static_cast<std::uint32_t>(columns.size()));
+    return rng.below(total) < columns[column].threshold
+               ? column
+               : columns[column].alias;
+  }
+
+  std::uint32_t size() const {
+    return static_cast<std::uint32_t>(columns.size());
+  }
+
+ private:
+  struct Column {
+    std::uint32_t threshold;  // Below it the column picks itself, out of total
+    std::uint32_t alias;
+  };
+
+  std::vector<Column> columns;
+  std::uint32_t total;
+};
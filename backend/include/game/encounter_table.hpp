@@ -0,0 +1,47 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Compiled per-area encounter tables with duplicate avoidance
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "game/alias_table.hpp"
+#include "game/random.hpp"
+#include "game/zone.hpp"
+
+// EncounterTable is a spawn area's encounters compiled for sampling. A
+// draw normally costs one alias table lookup. When that species is already
+// out in the zone, the draw is not retried: the species out are removed
+// from a prefix sum of the weights instead, and one binary search per
+// removed species finds the answer. The cost stays bounded however full
+// the zone is.
+class EncounterTable {
+ public:
+  // Throws:
+  //   std::invalid_argument: If encounters is empty, lists a species twice
+  //     or as zero, or has a zero weight or an invalid level range
+  explicit EncounterTable(std::vector<Encounter> encounters);
+
+  // Draws an encounter whose species is not in present (the species
+  // already out in the zone), with the table's weights among those left.
+  //
+  // Returns:
+  //   const Encounter*: nullptr when every species of the table is present
+  const Encounter* draw(Random& rng,
+                        std::span<const std::uint16_t> present) const;
+
+  const std::vector<Encounter>& encounters() const { return entries; }
+
+ private:
+  static constexpr std::uint16_t kAbsent = UINT16_MAX;
+
+  const Encounter* draw_excluding(
+      Random& rng, std::span<const std::uint16_t> present) const;
+
+  std::vector<Encounter> entries;
+  AliasTable alias;
+  std::vector<std::uint64_t> prefix;  // prefix[i]: weights of rows 0..i
+  std::vector<std::uint16_t> row_of;  // Row of each species, or kAbsent
+};
@@ -0,0 +1,156 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// WebSocket game channel with compact binary frames
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include <crow.h>
+
+#include "game/movement_engine.hpp"
+#include "game/spawn_engine.hpp"
+
+struct GameChannelStats {
+  std::size_t connections;
+  std::uint64_t frames;        // Frames sent
+  std::uint64_t bytes;         // Payload bytes sent
+  std::uint64_t messages;      // Messages received
+  std::uint64_t bad_messages;  // Received messages that could not be read
+  std::uint64_t deferred;      // Frames held back by backpressure
+  std::uint64_t closed_slow;   // Connections closed for not reading
+  std::uint64_t dropped;       // Replies lost to a full outbox
+};
+
+// GameChannel carries real-time play over one WebSocket per player: the
+// client sends steps and zone changes, the server pushes its zone's
+// spawns and players. Every message is a type byte followed by
+// fixed-width little-endian fields, and a frame may hold several:
+//
+//   Client to server
+//     0x01 enter    u32 zone
+//     0x02 move     u8 direction (0 up, 1 down, 2 left, 3 right)
+//   Server to client
+//     0x81 entered  u32 zone, u32 player
+//     0x82 spawns   u32 changed tick, u16 count,
+//                   count x (u16 species, u8 level, u16 x, u16 y)
+//     0x83 players  u32 changed tick, u16 count,
+//                   count x (u32 player, u16 x, u16 y)
+//     0x84 error    u8 code (1 bad message, 2 zone not found,
+//                   3 not in zone, 4 busy)
+//
+// Nothing is sent per event. flush() runs once per movement tick and
+// coalesces everything a connection is owed into at most one frame: its
+// replies, then a snapshot of its zone's spawns and players if either
+// changed since the last one it got. Each zone's snapshot is encoded once
+// per tick and shared by every connection in the zone.
+//
+// A connection whose socket has more than send_limit bytes unwritten
+// gets no frame that tick; since snapshots replace each other, it simply
+// catches up with the latest state once it drains. One that stays over
+// the limit for stall_ticks ticks is closed, so a client that stops
+// reading cannot hold memory on the server.
+//
+// The Crow handlers (accept, open, message, close) run on I/O threads;
+// flush() runs on the movement tick thread.
+//
+// Example usage:
+//   GameChannel channel(spawns, movement, 64 * 1024, 100);
+//   CROW_WEBSOCKET_ROUTE(app, "/game")
+//       .onaccept([&](const crow::request& req, void** session) { ... })
+//       .onopen([&](auto& conn) { channel.open(conn); })
+//       ...;
+class GameChannel {
+ public:
+  GameChannel(const SpawnEngine& spawns, MovementEngine& movement,
+              std::size_t send_limit, std::uint32_t stall_ticks);
+  ~GameChannel();
+
+  GameChannel(const GameChannel&) = delete;
+  GameChannel& operator=(const GameChannel&) = delete;
+
+  // Creates the state of an authenticated connection, to be stored as
+  // the connection's userdata
+  void* accept(std::string username, std::string session_id);
+
+  void open(crow::websocket::connection& connection);
+  void message(crow::websocket::connection& connection,
+               const std::string& data, bool is_binary);
+
+  // Safe to call more than once for a connection
+  void close(crow::websocket::connection& connection);
+
+  // Closes the connections opened with session_id's token, once the
+  // session has ended. Visits every connection; logouts are rare.
+  void end_session(const std::string& session_id);
+
+  // Sends each connection what it is owed since the last flush
+  void flush();
+
+  GameChannelStats stats() const;
+
+ private:
+  static constexpr std::uint32_t kNoZone = UINT32_MAX;
+  static constexpr std::uint64_t kNever = UINT64_MAX;
+
+  struct Session {
+    std::string username;
+    std::string session_id;
+    crow::websocket::connection* connection = nullptr;
+    std::size_t index = 0;  // In sessions
+
+    // Under mutex; message() and flush() both touch these
+    std::mutex mutex;
+    std::uint32_t zone = kNoZone;
+    std::uint64_t ticket = 0;             // Of this connection's enter()
+    std::uint64_t spawns_sent = kNever;   // Changed tick of the last sent
+    std::uint64_t players_sent = kNever;
+    std::string outbox;                   // Replies for the next frame
+
+    // flush() only
+    std::uint32_t stalled = 0;  // Consecutive ticks held back
+
+    // Set by whoever closes the connection first
+    std::atomic<bool> closing{false};
+  };
+
+  // A zone's snapshots as encoded for this flush
+  struct Snapshot {
+    std::uint64_t flush = 0;  // Flush that encoded it
+    std::uint64_t spawns_changed = 0;
+    std::uint64_t players_changed = 0;
+    std::string spawns;
+    std::string players;
+  };
+
+  void reply_error(Session& session, std::uint8_t code);
+  const Snapshot& snapshot(std::uint32_t zone);
+
+  const SpawnEngine& spawn_engine;
+  MovementEngine& movement;
+  const std::size_t send_limit;
+  const std::uint32_t stall_ticks;
+
+  mutable std::shared_mutex sessions_mutex;
+  std::vector<Session*> sessions;  // Open connections
+
+  // flush() only
+  std::uint64_t flushes = 0;
+  std::vector<Snapshot> snapshots;  // Indexed by zone
+  std::vector<Spawn> spawn_scratch;
+  std::vector<PlayerPosition> player_scratch;
+  std::string frame;
+
+  std::atomic<std::uint64_t> frames{0};
+  std::atomic<std::uint64_t> bytes{0};
+  std::atomic<std::uint64_t> messages{0};
+  std::atomic<std::uint64_t> bad_messages{0};
+  std::atomic<std::uint64_t> deferred{0};
+  std::atomic<std::uint64_t> closed_slow{0};
+  std::atomic<std::uint64_t> dropped{0};
+};
@@ -0,0 +1,207 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Server-side player movement, applied in batches once per tick
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "game/spatial_grid.hpp"
+#include "game/spawn_engine.hpp"
+#include "game/zone.hpp"
+#include "utils/mpsc_queue.hpp"
+
+enum class Direction : std::uint8_t { kUp, kDown, kLeft, kRight };
+
+// Parses "up", "down", "left" or "right"
+std::optional<Direction> parse_direction(std::string_view name);
+
+// Where a player stands, as published after a tick
+struct PlayerPosition {
+  std::uint32_t player;
+  std::uint16_t x;
+  std::uint16_t y;
+};
+
+// What enter() gives the caller
+struct ZoneEntry {
+  std::uint32_t player;  // Id in published positions
+  std::uint64_t ticket;  // Identifies this enter() call, for leave()
+};
+
+enum class MoveStatus {
+  kQueued,
+  kNotInZone,  // The player has not entered that zone
+  kBusy,       // The input queue is full
+};
+
+struct MovementStats {
+  std::size_t players;    // Players in a zone
+  std::uint64_t tick;
+  std::uint64_t steps;    // Inputs that moved a player
+  std::uint64_t blocked;  // Inputs stopped by a wall, the map edge or
+                          // another player
+  std::uint64_t stale;    // Inputs beyond one per player per tick, or from
+                          // a player who has since left
+  std::uint64_t dropped;  // Inputs refused because the queue was full
+  std::size_t queue_capacity;
+};
+
+// MovementEngine owns the players in every zone instance and moves them
+// on the server: clients send directions, never positions.
+//
+// Request threads only enqueue. A move goes onto a lock-free MpscQueue
+// and the request returns at once; entering and leaving go onto a short
+// list under a mutex. Once per tick the engine drains both, applies every
+// input in one pass grouped by zone, and publishes each changed zone's
+// positions. A player takes at most one step per tick, onto a walkable
+// tile of the zone's map that no other player stands on; further inputs
+// in the same tick are discarded. Only tick() writes the world, so the
+// pass itself takes no locks; readers see positions as of the last tick.
+//
+// Zones are numbered as in SpawnEngine when built from the same groups.
+//
+// Example usage:
+//   MovementEngine movement(groups, 65536);
+//   TickScheduler ticks("movement", 100ms, [&] { movement.tick(); });
+//   ZoneEntry entry = movement.enter("ash", zone);
+//   movement.submit("ash", zone, Direction::kUp);
+class MovementEngine {
+ public:
+  // Throws:
+  //   std::invalid_argument: If a zone template is invalid
+  MovementEngine(const std::vector<ZoneGroup>& groups,
+                 std::size_t queue_capacity);
+
+  MovementEngine(const MovementEngine&) = delete;
+  MovementEngine& operator=(const MovementEngine&) = delete;
+
+  // Puts name in zone (which must be below zone_count()) from the next
+  // tick, at the zone's entry or the nearest free tile to it; if every
+  // tile is taken, the player stays out. A player already in another zone
+  // moves over. Safe from any thread.
+  ZoneEntry enter(const std::string& name, std::size_t zone);
+
+  // Takes name out of its zone from the next tick. Safe from any thread.
+  //
+  // Returns:
+  //   bool: false if name was not in a zone
+  bool leave(const std::string& name);
+
+  // Like leave(), but only if name has not entered again (from another
+  // connection, say) since the enter() that returned ticket
+  bool leave(const std::string& name, std::uint64_t ticket);
+
+  // Queues one step for name, applied on the next tick. Safe from any
+  // thread and never blocks on the tick.
+  MoveStatus submit(const std::string& name, std::size_t zone,
+                    Direction direction);
+
+  // Applies queued joins, departures and steps, then publishes the zones
+  // that changed. Called from one thread.
+  //
+  // Returns:
+  //   std::size_t: Inputs applied, steps and blocked moves alike
+  std::size_t tick();
+
+  std::size_t zone_count() const { return zones.size(); }
+
+  // Replaces out with the players in zone, which must be below
+  // zone_count(), as of the last tick.
+  //
+  // Returns:
+  //   std::uint64_t: The tick at which the zone last changed
+  std::uint64_t players(std::size_t zone,
+                        std::vector<PlayerPosition>& out) const;
+
+  MovementStats stats() const;
+
+ private:
+  static constexpr std::uint32_t kNoZone = UINT32_MAX;
+
+  // A step as queued by submit()
+  struct Input {
+    std::uint32_t player;
+    std::uint32_t generation;
+    std::uint32_t zone;
+    Direction direction;
+  };
+
+  // Where a player is meant to be. Kept per name by the request side, and
+  // queued by enter() and leave() (zone kNoZone) for the tick to apply.
+  struct Membership {
+    std::uint32_t player;
+    std::uint32_t generation;  // Bumped each time the id is reused
+    std::uint32_t zone;
+    std::uint64_t ticket = 0;  // Of the latest enter(); directory only
+  };
+
+  // The tick's view of a player
+  struct Player {
+    std::uint32_t generation = 0;
+    std::uint32_t zone = kNoZone;
+    std::uint32_t slot = 0;  // Id in the zone's grid
+    std::uint16_t x = 0;
+    std::uint16_t y = 0;
+    std::uint64_t moved = UINT64_MAX;  // Tick of the last step
+  };
+
+  struct Zone {
+    explicit Zone(const ZoneTemplate& rules);
+
+    const ZoneTemplate* rules;
+    SpatialGrid grid;                     // Keyed by slot
+    std::vector<std::uint32_t> members;   // Player of each slot
+    bool dirty = false;                   // Changed during this tick
+    std::vector<PlayerPosition> scratch;  // Next positions to publish
+
+    // Swapped with scratch by tick() under publish_mutex
+    std::vector<PlayerPosition> published;
+    std::uint64_t changed = 0;
+  };
+
+  void apply(const Membership& change);
+  void join(std::uint32_t id, std::uint32_t zone_index);
+  void depart(Player& player);
+  bool step(Player& player, Direction direction);
+  bool occupied(const Zone& zone, int x, int y) const;
+  void touch(std::uint32_t zone_index);
+  void publish();
+
+  std::vector<ZoneTemplate> templates;
+  std::vector<Zone> zones;
+
+  // Request side
+  mutable std::shared_mutex directory_mutex;
+  std::unordered_map<std::string, Membership> directory;
+  std::vector<std::uint32_t> generations;  // Latest of each player id
+  std::vector<std::uint32_t> free_ids;
+  std::uint64_t tickets = 0;  // enter() calls so far
+
+  std::mutex membership_mutex;
+  std::vector<Membership> memberships;
+  MpscQueue<Input> inputs;
+
+  // Tick side
+  std::uint64_t current = 0;
+  std::vector<Player> roster;  // Indexed by player id
+  std::vector<Membership> pending_memberships;
+  std::vector<Input> batch;
+  std::vector<std::uint32_t> dirty_zones;
+
+  mutable std::shared_mutex publish_mutex;
+  std::atomic<std::uint64_t> published_tick{0};
+  std::atomic<std::size_t> player_count{0};
+  std::atomic<std::uint64_t> steps{0};
+  std::atomic<std::uint64_t> blocked{0};
+  std::atomic<std::uint64_t> stale{0};
+  std::atomic<std::uint64_t> dropped{0};
+};
@@ -0,0 +1,72 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Small, fast, seedable random number generator for the game simulation
+
+#pragma once
+
+#include <cstdint>
+
+// Random is xoshiro256**: four words of state, a few cycles per number,
+// and the same sequence for the same seed on every platform, so a
+// simulation can be replayed from its seed. Not for anything secret; use
+// OpenSSL for tokens and salts.
+//
+// Example usage:
+//   Random rng(seed);
+//   const std::uint32_t column = rng.below(columns);
+class Random {
+ public:
+  // Expands seed into the full state with SplitMix64, as the xoshiro
+  // authors recommend, so similar seeds still give unrelated sequences
+  explicit Random(std::uint64_t seed) {
+    for (std::uint64_t& word : state) {
+      seed += 0x9e3779b97f4a7c15ULL;
+      std::uint64_t z = seed;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      word = z ^ (z >> 31);
+    }
+  }
+
+  std::uint64_t next() {
+    const std::uint64_t result = rotl(state[1] * 5, 7) * 9;
+    const std::uint64_t t = state[1] << 17;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = rotl(state[3], 45);
+    return result;
+  }
+
+  // Uniform in [0, bound), without modulo bias; bound must not be zero.
+  // Lemire's multiply-shift method, which almost never needs a division.
+  std::uint32_t below(std::uint32_t bound) {
+    std::uint64_t product = (next() >> 32) * bound;
+    auto low = static_cast<std::uint32_t>(product);
+    if (low < bound) {
+      const std::uint32_t threshold = (0u - bound) % bound;
+      while (low < threshold) {
+        product = (next() >> 32) * bound;
+        low = static_cast<std::uint32_t>(product);
+      }
+    }
+    return static_cast<std::uint32_t>(product >> 32);
+  }
+
+  // Uniform in [low, high]
+  std::uint32_t between(std::uint32_t low, std::uint32_t high) {
+    return high - low == UINT32_MAX ? static_cast<std::uint32_t>(next())
+                                    : low + below(high - low + 1);
+  }
+
+  // Uniform in [0, 1) with 53 bits of precision
+  double unit() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+
+ private:
+  static std::uint64_t rotl(std::uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+
+  std::uint64_t state[4];
+};
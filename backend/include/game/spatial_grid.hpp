@@ -0,0 +1,143 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Uniform-grid spatial index over the tiles of a zone
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// An entity in a SpatialGrid: its id and the tile it stands on
+struct GridEntry {
+  std::uint32_t id;
+  std::uint16_t x;
+  std::uint16_t y;
+};
+
+// SpatialGrid buckets entities (spawned Pokémon, players) by square cells
+// of 2^cell_bits tiles. Each cell keeps its entries, positions included,
+// in one contiguous array, so a query reads only the cells it overlaps
+// and never looks anything up per entity. Insert, remove and move are
+// O(1); a rectangle or radius query is O(cells overlapped + k), however
+// many entities the rest of the map holds.
+//
+// Ids index a flat table of positions, so they should be small and dense,
+// e.g. slots of the caller's own entity array.
+//
+// Not thread-safe: the owner serialises access, as the game tick does.
+//
+// Example usage:
+//   SpatialGrid grid(26, 26);
+//   grid.insert(player, 4, 10);
+//   grid.move(player, 5, 10);
+//   std::vector<GridEntry> near;
+//   grid.query_radius(5, 10, 3, near);
+class SpatialGrid {
+ public:
+  // Throws:
+  //   std::invalid_argument: If the map is empty or cell_bits is over 15
+  SpatialGrid(std::uint16_t width, std::uint16_t height,
+              unsigned cell_bits = 3);
+
+  // Throws:
+  //   std::invalid_argument: If id is already in the grid or (x, y) is
+  //     off the map
+  void insert(std::uint32_t id, std::uint16_t x, std::uint16_t y);
+
+  // Returns:
+  //   bool: false if id was not in the grid
+  bool remove(std::uint32_t id);
+
+  // Moves id to (x, y). A move within one cell only rewrites the entry.
+  //
+  // Throws:
+  //   std::invalid_argument: If id is not in the grid or (x, y) is off
+  //     the map
+  void move(std::uint32_t id, std::uint16_t x, std::uint16_t y);
+
+  bool contains(std::uint32_t id) const {
+    return id < where.size() && where[id].cell != kAbsent;
+  }
+
+  // Entities in the grid
+  std::size_t size() const { return count; }
+
+  std::uint16_t width() const {
+    return static_cast<std::uint16_t>(map_width);
+  }
+  std::uint16_t height() const {
+    return static_cast<std::uint16_t>(map_height);
+  }
+
+  // Calls visit(const GridEntry&) for every entity in the rectangle from
+  // (x0, y0) to (x1, y1), both corners included. Parts of the rectangle
+  // off the map are ignored. visit must not modify the grid.
+  template <typename Visit>
+  void for_each_in_rect(int x0, int y0, int x1, int y1, Visit&& visit) const {
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, map_width - 1);
+    y1 = std::min(y1, map_height - 1);
+    if (x0 > x1 || y0 > y1) return;
+    for (int cy = y0 >> cell_bits; cy <= y1 >> cell_bits; ++cy) {
+      const std::vector<GridEntry>* row = &cells[cy * columns];
+      for (int cx = x0 >> cell_bits; cx <= x1 >> cell_bits; ++cx) {
+        for (const GridEntry& entry : row[cx]) {
+          if (entry.x >= x0 && entry.x <= x1 && entry.y >= y0 &&
+              entry.y <= y1) {
+            visit(entry);
+          }
+        }
+      }
+    }
+  }
+
+  // Replaces out with the entities in the rectangle, corners included
+  void query_rect(int x0, int y0, int x1, int y1,
+                  std::vector<GridEntry>& out) const {
+    out.clear();
+    for_each_in_rect(x0, y0, x1, y1,
+                     [&out](const GridEntry& entry) { out.push_back(entry); });
+  }
+
+  // Replaces out with the entities at most radius tiles (straight-line
+  // distance) from (x, y)
+  void query_radius(int x, int y, int radius,
+                    std::vector<GridEntry>& out) const {
+    out.clear();
+    const int limit = radius * radius;
+    for_each_in_rect(x - radius, y - radius, x + radius, y + radius,
+                     [&](const GridEntry& entry) {
+                       const int dx = entry.x - x;
+                       const int dy = entry.y - y;
+                       if (dx * dx + dy * dy <= limit) out.push_back(entry);
+                     });
+  }
+
+  // Memory held by the cells and the position table
+  std::size_t bytes() const;
+
+ private:
+  static constexpr std::uint32_t kAbsent = UINT32_MAX;
+
+  // Where an id's entry lives
+  struct Location {
+    std::uint32_t cell = kAbsent;
+    std::uint32_t slot = 0;  // Index in that cell's array
+  };
+
+  std::uint32_t cell_of(std::uint16_t x, std::uint16_t y) const {
+    return (y >> cell_bits) * columns + (x >> cell_bits);
+  }
+  void check_on_map(std::uint16_t x, std::uint16_t y) const;
+  void unlink(const Location& location);
+
+  int map_width;
+  int map_height;
+  unsigned cell_bits;
+  std::uint32_t columns;
+  std::vector<std::vector<GridEntry>> cells;
+  std::vector<Location> where;  // Indexed by id
+  std::size_t count = 0;
+};
@@ -0,0 +1,144 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Authoritative spawning of wild Pokémon in live zone instances
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <shared_mutex>
+#include <vector>
+
+#include "game/encounter_table.hpp"
+#include "game/random.hpp"
+#include "game/zone.hpp"
+#include "utils/timer_wheel.hpp"
+
+// A Pokémon currently in a zone
+struct Spawn {
+  std::uint16_t species;
+  std::uint16_t x;
+  std::uint16_t y;
+  std::uint8_t level;
+};
+
+// Live instances of one zone template
+struct ZoneGroup {
+  ZoneTemplate zone;
+  std::size_t instances;
+};
+
+struct SpawnEngineStats {
+  std::size_t zones;        // Live zone instances
+  std::size_t areas;        // Spawn areas across all instances
+  std::size_t live;         // Pokémon currently spawned
+  std::uint64_t tick;
+  std::uint64_t spawned;    // Since startup
+  std::uint64_t despawned;
+  std::size_t bytes;        // Memory held by the zones and their areas
+};
+
+// SpawnEngine owns every live zone instance and decides, on the server,
+// where and when wild Pokémon appear. It advances one tick at a time,
+// driven by a TickScheduler.
+//
+// Every spawn area of every instance has one pending event on a
+// TimerWheel: its next spawn roll while it is empty, or its Pokémon
+// leaving while it is occupied. Rather than rolling every empty area each
+// tick, the number of ticks until the next successful roll is drawn
+// directly (a geometric distribution with the zone's spawn chance). A tick
+// therefore costs only as much as the events that fall on it, so
+// thousands of mostly quiet instances are cheap to keep live.
+//
+// Species are drawn from each area's EncounterTable with a seeded Random,
+// so a run can be replayed from its seed.
+//
+// Zones are created up front and numbered from zero in the order of
+// their groups. tick() runs on one thread; readers may call spawns() and
+// stats() concurrently from any thread.
+//
+// Example usage:
+//   SpawnEngine engine({{meadow_zone(), 1000}});
+//   TickScheduler ticks("spawn", 1s, [&engine] { engine.tick(); });
+//   std::vector<Spawn> spawns;
+//   engine.spawns(zone, spawns);
+class SpawnEngine {
+ public:
+  // Throws:
+  //   std::invalid_argument: If a zone template or encounter table is
+  //     invalid
+  explicit SpawnEngine(std::vector<ZoneGroup> groups,
+                       std::uint64_t seed = std::random_device()());
+
+  SpawnEngine(const SpawnEngine&) = delete;
+  SpawnEngine& operator=(const SpawnEngine&) = delete;
+
+  // Advances every zone by one tick.
+  //
+  // Returns:
+  //   std::size_t: Spawns and departures that happened
+  std::size_t tick();
+
+  std::size_t zone_count() const { return zones.size(); }
+
+  // Ticks run so far
+  std::uint64_t now() const;
+
+  // The template zone is an instance of
+  const ZoneTemplate& zone_template(std::size_t zone) const {
+    return templates[zones[zone].group];
+  }
+
+  // Replaces out with the Pokémon currently in zone, which must be below
+  // zone_count().
+  //
+  // Returns:
+  //   std::uint64_t: The tick at which the zone last changed, so callers
+  //     can skip resending an unchanged zone
+  std::uint64_t spawns(std::size_t zone, std::vector<Spawn>& out) const;
+
+  SpawnEngineStats stats() const;
+
+ private:
+  // One spawn area of one instance. Laid out in a single vector that
+  // never reallocates, since the wheel links slots by address.
+  struct Slot : TimerNode {
+    std::uint32_t zone;
+    std::uint16_t area;
+    std::uint16_t species = 0;  // 0 while empty
+    std::uint16_t x = 0;
+    std::uint16_t y = 0;
+    std::uint8_t level = 0;
+  };
+
+  struct Zone {
+    std::uint32_t group;
+    std::uint32_t first_slot;
+    std::uint64_t changed = 0;  // Tick of the last spawn or departure
+  };
+
+  // Called when slot's event comes due
+  void fire(Slot& slot);
+
+  // Picks the species, level and tile of a new spawn in slot.
+  //
+  // Returns:
+  //   bool: false if every species of the area is already out
+  bool place(Slot& slot, const ZoneTemplate& zone);
+  void schedule_spawn(Slot& slot, const ZoneTemplate& zone);
+
+  std::vector<ZoneTemplate> templates;
+  std::vector<std::uint32_t> first_table;  // Of each template, in tables
+  std::vector<EncounterTable> tables;      // One per area of each template
+  std::vector<Zone> zones;
+  std::vector<Slot> slots;
+  TimerWheel wheel;
+  Random rng;
+  std::vector<std::uint16_t> present;  // Scratch for place()
+
+  // Shared by readers; tick() holds it exclusively while it applies events
+  mutable std::shared_mutex mutex;
+  std::size_t live = 0;
+  std::uint64_t spawned = 0;
+  std::uint64_t despawned = 0;
+};
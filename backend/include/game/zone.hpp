@@ -0,0 +1,82 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Zone templates: map size, spawn rectangles and spawn timing
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One row of an encounter table: a species that can appear, how often
+// relative to the other rows, and at which levels
+struct Encounter {
+  std::uint16_t species;
+  std::uint32_t weight;
+  std::uint8_t min_level;
+  std::uint8_t max_level;
+};
+
+// A rectangle of tiles where wild Pokémon appear. Start coordinates are
+// inclusive, end coordinates exclusive.
+struct SpawnArea {
+  std::uint16_t start_x;
+  std::uint16_t start_y;
+  std::uint16_t end_x;
+  std::uint16_t end_y;
+
+  // Species that appear here; compiled into an EncounterTable at load
+  std::vector<Encounter> encounters;
+};
+
+// ZoneTemplate describes one kind of zone. Every live instance of it has
+// the same areas and rules, and its own spawns. Each area holds at most
+// one Pokémon at a time, and no species appears twice in an instance: an
+// area whose every species is already out stays empty until its next
+// spawn roll.
+struct ZoneTemplate {
+  std::string name;
+
+  // Size of the map in tiles
+  std::uint16_t width;
+  std::uint16_t height;
+
+  std::vector<SpawnArea> areas;
+
+  // Chance per tick that an empty area gets a Pokémon, in (0, 1]
+  double spawn_chance;
+
+  // Ticks a Pokémon stays before it leaves, picked uniformly in the range
+  std::uint32_t min_lifetime;
+  std::uint32_t max_lifetime;
+
+  // The map row by row, width characters per row: '#' is a tile players
+  // cannot walk onto (trees, ledges), anything else is open. Empty means
+  // the whole map is open.
+  std::string tiles;
+
+  // Where players appear when they enter the zone
+  std::uint16_t entry_x;
+  std::uint16_t entry_y;
+
+  bool walkable(std::uint16_t x, std::uint16_t y) const {
+    return x < width && y < height &&
+           (tiles.empty() || tiles[std::size_t{y} * width + x] != '#');
+  }
+
+  // Checks the map and timing; encounter tables are checked when they
+  // are compiled.
+  //
+  // Throws:
+  //   std::invalid_argument: If an area is empty or off the map, the tile
+  //     map has the wrong size, the entry is blocked, or the timing
+  //     cannot work
+  void validate() const;
+};
+
+// The starting meadow shown by the game page: a 26x26 grid with the four
+// spawn areas the browser used to roll locally, each with its own
+// encounters, and the trees and ledges of its background as blocked
+// tiles. A spawn lasts one to two minutes at one tick per second.
+// Players enter from the path at the top.
+ZoneTemplate meadow_zone();
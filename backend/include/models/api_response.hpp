@@ -0,0 +1,98 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// This file defines the standard response body shared by every endpoint
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <crow.h>
+
+#include "utils/json_writer.hpp"
+
+// Builds an HTTP response with a JSON body
+inline crow::response json_response(int code, std::string_view body) {
+  crow::response res(code, std::string(body));
+  res.set_header("Content-Type", "application/json");
+  return res;
+}
+
+// ApiResponse defines the standard structure for all API responses.
+// Used to maintain consistent communication format with the frontend.
+class ApiResponse {
+ public:
+  // Human-readable message describing the operation result
+  std::string message;
+
+  // Standard HTTP status code indicating the type of response
+  int http_status_code;
+
+  // Writes the message and httpStatusCode members into the object json is
+  // in, so endpoints can add their own members after them
+  void WriteFields(JsonWriter& json) const {
+    json.key("message").value(message);
+    json.key("httpStatusCode").value(http_status_code);
+  }
+
+  // Converts the ApiResponse object to JSON text
+  std::string ToJson() const {
+    JsonWriter json = JsonWriter::local();
+    json.begin_object();
+    WriteFields(json);
+    json.end_object();
+    return std::string(json.view());
+  }
+
+  // The HTTP response carrying this body, with http_status_code as status
+  crow::response ToResponse() const {
+    JsonWriter json = JsonWriter::local();
+    json.begin_object();
+    WriteFields(json);
+    json.end_object();
+    return json_response(http_status_code, json.view());
+  }
+};
+
+// An ApiResponse whose message never changes, serialized once at startup
+// instead of on every request
+class FixedResponse {
+ public:
+  FixedResponse(std::string message, int http_status_code)
+      : code(http_status_code),
+        body(ApiResponse{std::move(message), http_status_code}.ToJson()) {}
+
+  crow::response ToResponse() const { return json_response(code, body); }
+
+ private:
+  int code;
+  std::string body;
+};
+
+// Fixed responses shared by the endpoints and middlewares
+namespace responses {
+
+inline const FixedResponse kMissingFields{
+    "Missing required fields in request", 400};
+inline const FixedResponse kInvalidFormat{"Invalid request format", 400};
+inline const FixedResponse kInvalidEmail{"Invalid email format", 400};
+inline const FixedResponse kInvalidDirection{
+    "Direction must be up, down, left or right", 400};
+inline const FixedResponse kInvalidCredentials{
+    "Invalid username or password", 401};
+inline const FixedResponse kInvalidToken{
+    "Missing or invalid session token", 401};
+inline const FixedResponse kSessionNotFound{"Session not found", 404};
+inline const FixedResponse kZoneNotFound{"Zone not found", 404};
+inline const FixedResponse kNotInZone{"Enter the zone before moving in it",
+                                      409};
+inline const FixedResponse kTooManyRequests{
+    "Too many requests, please try again later", 429};
+inline const FixedResponse kInternalError{"Internal server error", 500};
+inline const FixedResponse kServerBusy{
+    "Server is busy, please try again later", 503};
+inline const FixedResponse kUserRegistered{"User successfully registered", 201};
+inline const FixedResponse kSessionEnded{"Session ended", 200};
+inline const FixedResponse kMoveQueued{"Move queued", 202};
+
+}  // namespace responses
@@ -0,0 +1,52 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// This file defines the request bodies accepted by the REST endpoints
+
+#pragma once
+
+#include <string_view>
+#include <tuple>
+
+#include "utils/request_schema.hpp"
+
+// Each request lists its JSON fields once in kSchema; parse_request fills
+// it from the body in a single pass. The string_view members point into
+// the request body (or the decoded buffer passed to parse_request), so
+// copy them before the request goes away.
+
+// Body of POST /signup
+struct SignupRequest {
+  std::string_view username;
+  std::string_view email;
+  std::string_view password;
+
+  static constexpr auto kSchema = std::make_tuple(
+      required_field("username", &SignupRequest::username),
+      required_field("email", &SignupRequest::email),
+      required_field("password", &SignupRequest::password));
+};
+
+// Body of POST /login
+struct LoginRequest {
+  std::string_view username;
+  std::string_view password;
+
+  static constexpr auto kSchema = std::make_tuple(
+      required_field("username", &LoginRequest::username),
+      required_field("password", &LoginRequest::password));
+};
+
+// Body of POST /logout
+struct LogoutRequest {
+  std::string_view session_id;
+
+  static constexpr auto kSchema = std::make_tuple(
+      required_field("sessionId", &LogoutRequest::session_id));
+};
+
+// Body of POST /zones/<id>/move
+struct MoveRequest {
+  std::string_view direction;
+
+  static constexpr auto kSchema = std::make_tuple(
+      required_field("direction", &MoveRequest::direction));
+};
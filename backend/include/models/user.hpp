@@ -5,7 +5,7 @@
 
 #include <string>
 
-#include <crow.h>
+#include "utils/json_writer.hpp"
 
 // The User class represents a user entity in the system.
 // It encapsulates all user-related data and provides methods
@@ -15,18 +15,15 @@ class User {
   // Core user identification and authentication data
   std::string username;  // Unique username for the user
   std::string email;     // User's email address (must be unique)
-  std::string password;  // User's password (should be hashed in production)
+  std::string password;  // Password from the request; hashed before storage
 
-  // Converts User object to JSON format for API responses
+  // Writes the User object as a JSON object for API responses
   // Note: password is intentionally excluded from JSON output
   // for security purposes
-  //
-  // Returns:
-  //   crow::json::wvalue: JSON object containing user data
-  crow::json::wvalue ToJson() const {
-    crow::json::wvalue json;
-    json["username"] = username;  // Include username in response
-    json["email"] = email;        // Include email in response
-    return json;                  // Password is deliberately omitted
+  void ToJson(JsonWriter& json) const {
+    json.begin_object();
+    json.key("username").value(username);  // Include username in response
+    json.key("email").value(email);        // Include email in response
+    json.end_object();                     // Password is deliberately omitted
   }
 };
\ No newline at end of file
@@ -0,0 +1,105 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Load shedding driven by the backlog and recent latency of a worker pool
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "utils/metrics.hpp"
+#include "utils/worker_pool.hpp"
+
+// How readily a route's requests are shed under load
+enum class AdmissionPriority {
+  kCritical,  // Never shed: health checks and monitoring
+  kNormal,    // Shed only under severe overload: logins and game actions
+  kLow,       // Shed first: new signups
+};
+
+// How overloaded the watched pool is
+enum class OverloadLevel {
+  kNone,
+  kElevated,  // A threshold is crossed: low priority requests are shed
+  kSevere,    // A threshold is crossed twice over: normal ones are too
+};
+
+// Limits past which the pool counts as overloaded. Zero disables a limit.
+struct AdmissionThresholds {
+  std::size_t queue_depth;        // Tasks waiting for a worker
+  std::chrono::milliseconds p99;  // Task latency over the recent window
+};
+
+struct AdmissionStats {
+  OverloadLevel level;
+  std::size_t queue_depth;  // As of the last refresh
+  std::uint64_t p99_us;     // Over the window, as of the last refresh
+  std::uint64_t rejected_normal;
+  std::uint64_t rejected_low;
+};
+
+// AdmissionController decides whether a request may start, so that when
+// MySQL slows down requests are refused at once with 503 instead of piling
+// up behind the database executor until clients time out.
+//
+// It watches the pool's queue depth and the p99 of its task latency over
+// a sliding window, kept as a ring of histogram snapshots. The overload
+// level is recomputed at most once per window slice, by whichever request
+// arrives first after the slice ends; every other request only reads an
+// atomic.
+//
+// Example usage:
+//   AdmissionController admission(db_executor, {256, 500ms}, 2s);
+//   if (!admission.admit(AdmissionPriority::kLow)) {
+//     Answer 503 with Retry-After
+//   }
+class AdmissionController {
+ public:
+  // Snapshots per window; the level is refreshed once per slice
+  static constexpr std::size_t kWindowSlices = 4;
+
+  AdmissionController(const WorkerPool& pool, AdmissionThresholds thresholds,
+                      std::chrono::milliseconds window);
+
+  AdmissionController(const AdmissionController&) = delete;
+  AdmissionController& operator=(const AdmissionController&) = delete;
+
+  // Whether a request of the given priority may proceed right now
+  bool admit(AdmissionPriority priority);
+
+  // Suggested client back-off: the window, in whole seconds
+  std::chrono::seconds retry_after() const { return retry_after_seconds; }
+
+  OverloadLevel level() const {
+    return overload.load(std::memory_order_relaxed);
+  }
+
+  AdmissionStats stats() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  void refresh(Clock::time_point now);
+
+  const WorkerPool& pool;
+  const AdmissionThresholds thresholds;
+  const Clock::duration slice;
+  const std::chrono::seconds retry_after_seconds;
+
+  std::atomic<Clock::rep> next_refresh{0};
+  std::atomic<OverloadLevel> overload{OverloadLevel::kNone};
+  std::atomic<std::size_t> queue_depth{0};
+  std::atomic<std::uint64_t> p99_ns{0};
+
+  // Held by the one request refreshing the level; others skip the refresh
+  std::mutex refresh_mutex;
+  std::array<HistogramSnapshot, kWindowSlices + 1> history;  // Ring
+  std::size_t history_next = 0;
+  Clock::time_point last_refresh;
+
+  const Counter rejected_normal;  // admission_rejected_total{priority=}
+  const Counter rejected_low;
+};
@@ -0,0 +1,42 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Crow middleware that sheds requests by route priority under overload
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include <crow.h>
+
+#include "utils/admission_control.hpp"
+
+// AdmissionMiddleware asks an AdmissionController whether each request may
+// start and answers 503 Service Unavailable, with a Retry-After header,
+// when it may not. That happens before any parsing, hashing or database
+// work, so shedding a request costs next to nothing.
+//
+// Each route has a priority, set with priority(); unlisted routes are
+// AdmissionPriority::kNormal. List it after MetricsMiddleware and
+// TraceMiddleware so refused requests are still counted and traced.
+//
+// Example usage:
+//   auto& admission = app.get_middleware<AdmissionMiddleware>();
+//   admission.controller = &controller;
+//   admission.priority("/", AdmissionPriority::kCritical);
+//   admission.priority("/signup", AdmissionPriority::kLow);
+struct AdmissionMiddleware {
+  struct context {};
+
+  // Decides admission; nullptr (the default) admits every request
+  AdmissionController* controller = nullptr;
+
+  // Sets the priority of the route with the given path. Call before the
+  // server starts.
+  void priority(const std::string& path, AdmissionPriority priority);
+
+  void before_handle(crow::request& req, crow::response& res, context& ctx);
+  void after_handle(crow::request&, crow::response&, context&) {}
+
+ private:
+  std::unordered_map<std::string, AdmissionPriority> routes;
+};
@@ -0,0 +1,22 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Helpers to keep threads on a chosen set of CPU cores
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Parses a CPU list such as "0-3,8,10-11" into core numbers, in order and
+// without duplicates. An empty list means no restriction.
+//
+// Throws:
+//   std::invalid_argument: If the list is malformed
+std::vector<int> parse_cpu_list(const std::string& list);
+
+// Restricts the calling thread to cpus. Threads it starts afterwards
+// inherit the restriction.
+//
+// Returns:
+//   bool: false if the platform does not support affinity (only Linux
+//     does) or refused the set, e.g. because a core does not exist
+bool set_thread_affinity(const std::vector<int>& cpus);
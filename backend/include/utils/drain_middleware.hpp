@@ -0,0 +1,36 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Crow middleware that tracks in-flight requests for a graceful drain
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+#include <crow.h>
+
+// DrainMiddleware counts the requests whose responses are not complete
+// yet, including those waiting on a worker pool, so shutdown can wait for
+// them. Once draining, every response asks the client to close its
+// connection, so keep-alive clients reconnect to a server that is staying
+// up.
+//
+// List it right after MetricsMiddleware so refused requests count too.
+struct DrainMiddleware {
+  struct context {
+    bool counted = false;
+  };
+
+  // Marks responses from now on with "Connection: close"
+  void start_draining() { draining.store(true, std::memory_order_relaxed); }
+
+  std::size_t in_flight() const {
+    return requests.load(std::memory_order_relaxed);
+  }
+
+  void before_handle(crow::request& req, crow::response& res, context& ctx);
+  void after_handle(crow::request& req, crow::response& res, context& ctx);
+
+ private:
+  std::atomic<bool> draining{false};
+  std::atomic<std::size_t> requests{0};
+};
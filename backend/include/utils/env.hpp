@@ -1,29 +1,85 @@
 #pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
 #include <string>
-#include <fstream>
-#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 
+// Immutable view of the .env file at one point in time. Lookups are O(1)
+// and need no locking because a snapshot never changes once published.
+class EnvSnapshot {
+public:
+    explicit EnvSnapshot(std::unordered_map<std::string, std::string> values, std::uint64_t version)
+        : values(std::move(values)), version(version) {}
+
+    std::string get(const std::string& key, const std::string& defaultValue = "") const {
+        auto it = values.find(key);
+        return it != values.end() ? it->second : defaultValue;
+    }
+
+    bool has(const std::string& key) const { return values.count(key) > 0; }
+
+    bool sameValues(const std::unordered_map<std::string, std::string>& other) const {
+        return values == other;
+    }
+
+    // Increases by one every time a changed file is loaded
+    std::uint64_t getVersion() const { return version; }
+
+private:
+    const std::unordered_map<std::string, std::string> values;
+    const std::uint64_t version;
+};
+
+// EnvLoader parses the .env file once and serves every lookup from the
+// current EnvSnapshot. reload() parses the file again and atomically swaps
+// in a new snapshot; readers never block and never see a half-built one.
+//
+// Replaced snapshots are kept alive until the process exits, so a
+// reference returned by snapshot() stays valid forever. Reloads are rare
+// (the file is edited by hand), so the retained memory is negligible.
+//
+// Values copied at startup (DBConfig, pool sizes, ...) keep their original
+// value; code that wants to follow edits must query the snapshot each time.
 class EnvLoader {
 public:
     static std::string getEnvVariable(const std::string& key, const std::string& defaultValue = "") {
-        std::ifstream file("../.env"); // Locates the .env file that will be read
-        std::string line;
-        
-        while (std::getline(file, line)) {
-            // Ignores empty lines or comments
-            if (line.empty() || line[0] == '#') continue;
-            
-            // Searchs for equal sign
-            auto pos = line.find('=');
-            if (pos == std::string::npos) continue;
-            
-            // Extracts the key and Value
-            std::string currentKey = line.substr(0, pos);
-            if (currentKey == key) {
-                return line.substr(pos + 1);
-            }
-        }
-        
-        return defaultValue;
+        return snapshot().get(key, defaultValue);
     }
-};
\ No newline at end of file
+
+    // Current snapshot, parsed on first use
+    static const EnvSnapshot& snapshot();
+
+    // Parses the file again and publishes it if its contents changed.
+    // Returns true when a new snapshot was published.
+    static bool reload();
+
+private:
+    static std::unordered_map<std::string, std::string> parseFile();
+};
+
+// Polls the .env file and calls EnvLoader::reload() when its modification
+// time or size changes, so configuration edits apply without a restart.
+// The polling thread stops when the watcher is destroyed.
+//
+// Example usage:
+//   EnvWatcher watcher(std::chrono::milliseconds(1000));
+class EnvWatcher {
+public:
+    explicit EnvWatcher(std::chrono::milliseconds interval);
+    ~EnvWatcher();
+
+    EnvWatcher(const EnvWatcher&) = delete;
+    EnvWatcher& operator=(const EnvWatcher&) = delete;
+
+private:
+    void run(std::chrono::milliseconds interval);
+
+    std::mutex mutex;
+    std::condition_variable stopRequested;
+    bool stopping = false;
+    std::thread thread;
+};
@@ -0,0 +1,21 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Case folding for names the users table compares case-insensitively
+
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+
+// Lowercases A-Z. The users table compares usernames and emails under
+// MySQL's default case-insensitive collation, so "Ash" and "ASH" name one
+// account; keys derived from them must be folded to agree. ASCII folding
+// covers the names people actually type; accented letters are left as
+// they are.
+inline std::string fold_case(std::string_view text) {
+  std::string folded(text);
+  std::transform(folded.begin(), folded.end(), folded.begin(), [](char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+  });
+  return folded;
+}
@@ -0,0 +1,81 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Drains the server on SIGINT and SIGTERM instead of stopping abruptly
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include <asio.hpp>
+
+#include "utils/drain_middleware.hpp"
+
+// GracefulShutdown turns SIGINT and SIGTERM into a drain. On the first
+// signal it:
+//   1. stops accepting connections; with SO_REUSEPORT, a replacement
+//      process listening on the same port takes the new ones,
+//   2. waits until no request is in flight, or until the deadline,
+//   3. stops the server, which makes App::run() return.
+// A second signal skips the wait. Finishing queued database work and
+// flushing logs is left to the caller, within deadline().
+//
+// Crow's own signal handling stops the server at once, so turn it off
+// with app.signal_clear().
+//
+// Example usage:
+//   app.signal_clear();
+//   GracefulShutdown shutdown(app.get_middleware<DrainMiddleware>(), 30s,
+//                             [&app] { app.stop_accepting(); },
+//                             [&app] { app.stop(); });
+//   app.run();
+//   db_executor.shutdown(shutdown.deadline());
+class GracefulShutdown {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  GracefulShutdown(DrainMiddleware& requests, std::chrono::milliseconds timeout,
+                   std::function<void()> stop_accepting,
+                   std::function<void()> stop);
+
+  // Stops watching for signals
+  ~GracefulShutdown();
+
+  GracefulShutdown(const GracefulShutdown&) = delete;
+  GracefulShutdown& operator=(const GracefulShutdown&) = delete;
+
+  // When the drain must be over: the first signal plus the timeout, or
+  // Clock::time_point::max() if no signal arrived
+  Clock::time_point deadline() const;
+
+ private:
+  // How often the in-flight count is checked while draining. The first
+  // check also waits this long, for requests on connections accepted just
+  // before the listener closed.
+  static constexpr std::chrono::milliseconds kPollInterval{50};
+
+  void wait_for_signal();
+  void begin_drain(int signal);
+  void check_drained();
+  void finish();
+
+  DrainMiddleware& requests;
+  const std::chrono::milliseconds timeout;
+  const std::function<void()> stop_accepting;
+  const std::function<void()> stop;
+
+  // Handlers below run on the watcher thread only
+  asio::io_context io;
+  asio::signal_set signals;
+  asio::steady_timer poll;
+  Clock::time_point drain_started;
+  bool draining = false;
+  bool stopped = false;
+
+  mutable std::mutex mutex;  // Guards drain_deadline
+  Clock::time_point drain_deadline = Clock::time_point::max();
+
+  std::thread watcher;
+};
@@ -0,0 +1,87 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Streaming JSON writer that serializes straight into a string buffer
+
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// JsonWriter appends JSON text to a string as values are written, with no
+// intermediate tree: commas and quotes are added as needed and strings are
+// escaped on the way in. It does not check that keys and values alternate
+// correctly; that is up to the caller.
+//
+// Responses are written into a per-thread buffer (JsonWriter::local()) that
+// keeps its capacity between requests, so serializing allocates nothing
+// once the buffer has grown to the size of the largest response.
+//
+// Example usage:
+//   JsonWriter json = JsonWriter::local();
+//   json.begin_object();
+//   json.key("username").value(user.username);
+//   json.key("wins").value(wins);
+//   json.end_object();
+//   send(json.view());
+class JsonWriter {
+ public:
+  // Appends to out, which must outlive the writer
+  explicit JsonWriter(std::string& out) : out(out) {}
+
+  // A writer over the calling thread's buffer, emptied first. Only one
+  // such writer may be in use per thread at a time; copy view() out before
+  // writing the next response.
+  static JsonWriter local();
+
+  JsonWriter& begin_object();
+  JsonWriter& end_object();
+  JsonWriter& begin_array();
+  JsonWriter& end_array();
+
+  // Starts a member of the current object; write its value next
+  JsonWriter& key(std::string_view name);
+
+  JsonWriter& value(std::string_view text);
+  JsonWriter& value(const char* text) { return value(std::string_view(text)); }
+  JsonWriter& value(const std::string& text) {
+    return value(std::string_view(text));
+  }
+  JsonWriter& value(bool flag);
+  JsonWriter& value(double number);  // NaN and infinities become null
+  JsonWriter& value(std::nullptr_t);
+  template <std::integral T>
+    requires(!std::same_as<T, bool>)
+  JsonWriter& value(T number) {
+    if constexpr (std::signed_integral<T>) {
+      return write_integer(static_cast<std::int64_t>(number));
+    } else {
+      return write_integer(static_cast<std::uint64_t>(number));
+    }
+  }
+
+  // Inserts already serialized JSON as the next value
+  JsonWriter& raw(std::string_view json);
+
+  // The text written so far
+  std::string_view view() const { return out; }
+
+ private:
+  // Nesting deeper than this is still written, but commas are only
+  // tracked for the first kMaxDepth levels
+  static constexpr int kMaxDepth = 64;
+
+  // Writes the comma before a value or key when one is needed
+  void separate();
+  JsonWriter& open(char bracket);
+  JsonWriter& close(char bracket);
+  JsonWriter& write_integer(std::int64_t number);
+  JsonWriter& write_integer(std::uint64_t number);
+  void write_string(std::string_view text);
+
+  std::string& out;
+  std::uint64_t has_items = 0;  // Bit per depth: container is non-empty
+  int depth = 0;
+  bool after_key = false;
+};
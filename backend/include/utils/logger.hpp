@@ -0,0 +1,233 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Asynchronous logger with per-thread ring buffers
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Records below this level are removed at compile time. Set it with
+// -DBACKEND_LOG_MIN_LEVEL=<0..3> (debug, info, warning, error).
+#ifndef BACKEND_LOG_MIN_LEVEL
+#define BACKEND_LOG_MIN_LEVEL 0
+#endif
+
+enum class LogLevel : int {
+  kDebug = 0,
+  kInfo = 1,
+  kWarning = 2,
+  kError = 3,
+};
+
+// Longest message kept per record; longer ones are truncated with "..."
+inline constexpr std::size_t kLogMessageCapacity = 232;
+
+// Records each thread can buffer before new ones are dropped
+inline constexpr std::size_t kLogRingCapacity = 512;
+
+// Counters reported by Logger::stats()
+struct LoggerStats {
+  std::uint64_t written;  // Records written to stdout/stderr
+  std::uint64_t dropped;  // Records lost because a thread's ring was full
+  std::size_t threads;    // Threads that currently own a ring
+};
+
+// One buffered log line. Fixed size so the rings never allocate.
+struct LogRecord {
+  std::int64_t timestamp_us;  // Microseconds since the Unix epoch
+  std::uint32_t thread;       // Small per-thread number assigned by Logger
+  LogLevel level;
+  std::uint16_t length;
+  char text[kLogMessageCapacity];
+};
+
+// Single-producer/single-consumer ring owned by one logging thread and
+// drained by the flusher. Producer and consumer indices sit on separate
+// cache lines so the two sides do not false-share.
+class LogRing {
+ public:
+  explicit LogRing(std::uint32_t thread) : thread(thread) {}
+
+  // Called by the owning thread only. Returns false (and counts a drop)
+  // when the ring is full.
+  bool push(LogLevel level, std::int64_t timestamp_us, std::string_view text);
+
+  // Called by the flusher only. Appends every buffered record to out.
+  void drain(std::vector<LogRecord>& out);
+
+  std::uint64_t dropped() const {
+    return dropped_count.load(std::memory_order_relaxed);
+  }
+  bool empty() const {
+    return head.load(std::memory_order_acquire) ==
+           tail.load(std::memory_order_acquire);
+  }
+
+  const std::uint32_t thread;
+
+  // Set when the owning thread exits; the flusher frees the ring once empty
+  std::atomic<bool> closed{false};
+
+ private:
+  alignas(64) std::atomic<std::size_t> head{0};  // Next record to read
+  alignas(64) std::atomic<std::size_t> tail{0};  // Next slot to write
+  std::atomic<std::uint64_t> dropped_count{0};
+  std::array<LogRecord, kLogRingCapacity> slots;
+};
+
+// Logger replaces direct std::cout/std::cerr writes on hot paths. A log
+// call formats into a stack buffer and copies one fixed-size record into
+// the calling thread's ring: no locks, no allocation and no system call.
+// A background thread drains all rings every few milliseconds, orders the
+// records by time and writes them with one fwrite per stream (info and
+// debug to stdout, warnings and errors to stderr).
+//
+// Memory is bounded by kLogRingCapacity records per thread. When a ring is
+// full the record is dropped and counted; the flusher reports the number
+// of dropped records so losses are visible.
+//
+// Use the LOG_* macros rather than calling Logger directly:
+//   LOG_INFO << "Attempting to create user: " << user.username;
+class Logger {
+ public:
+  static Logger& instance();
+
+  // Runtime threshold, on top of BACKEND_LOG_MIN_LEVEL
+  static bool enabled(LogLevel level) {
+    return static_cast<int>(level) >= runtime_level.load(std::memory_order_relaxed);
+  }
+  static void set_level(LogLevel level) {
+    runtime_level.store(static_cast<int>(level), std::memory_order_relaxed);
+  }
+
+  // Parses "debug", "info", "warning" or "error"; anything else means info
+  static LogLevel parse_level(const std::string& name);
+
+  // Buffers a record for the flusher
+  void submit(LogLevel level, std::string_view text);
+
+  // Writes every buffered record now. Used before exiting.
+  void flush();
+
+  LoggerStats stats() const;
+
+  Logger(const Logger&) = delete;
+  Logger& operator=(const Logger&) = delete;
+
+ private:
+  Logger();
+  ~Logger();
+
+  LogRing& ring_for_this_thread();
+  void flush_loop();
+
+  // Drains every ring and writes the records. Serialized by drain_mutex.
+  void drain();
+
+  static inline std::atomic<int> runtime_level{static_cast<int>(LogLevel::kInfo)};
+
+  mutable std::mutex rings_mutex;
+  std::vector<std::shared_ptr<LogRing>> rings;
+  std::uint32_t next_thread = 1;
+
+  std::mutex drain_mutex;
+  std::vector<LogRecord> pending;  // Reused by drain()
+  std::string out_buffer;          // Reused by drain()
+  std::string err_buffer;          // Reused by drain()
+  std::uint64_t dropped_reported = 0;
+  std::uint64_t dropped_retired = 0;  // Drops from rings already freed
+
+  std::atomic<std::uint64_t> written{0};
+
+  std::mutex wake_mutex;
+  std::condition_variable wake;
+  bool stopping = false;
+  std::thread flusher;
+};
+
+// Builds one log record on the stack. Created by the LOG_* macros; the
+// record is handed to the Logger when the statement ends.
+class LogLine {
+ public:
+  explicit LogLine(LogLevel level) : level(level) {}
+  ~LogLine() { Logger::instance().submit(level, std::string_view(buffer, length)); }
+
+  LogLine(const LogLine&) = delete;
+  LogLine& operator=(const LogLine&) = delete;
+
+  LogLine& operator<<(std::string_view text) {
+    append(text);
+    return *this;
+  }
+  LogLine& operator<<(const char* text) { return *this << std::string_view(text); }
+  LogLine& operator<<(const std::string& text) { return *this << std::string_view(text); }
+  LogLine& operator<<(char c) { return *this << std::string_view(&c, 1); }
+  LogLine& operator<<(bool value) { return *this << (value ? "true" : "false"); }
+
+  template <typename T,
+            std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, bool> &&
+                                 !std::is_same_v<T, char>,
+                             int> = 0>
+  LogLine& operator<<(T value) {
+    char digits[32];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    return *this << std::string_view(digits, result.ptr - digits);
+  }
+
+  // Anything else that can be streamed (e.g. sql::SQLString). Allocates,
+  // so keep it off hot paths.
+  template <typename T,
+            std::enable_if_t<!std::is_arithmetic_v<T> &&
+                                 !std::is_convertible_v<const T&, std::string_view>,
+                             int> = 0>
+  LogLine& operator<<(const T& value) {
+    std::ostringstream stream;
+    stream << value;
+    return *this << stream.str();
+  }
+
+ private:
+  void append(std::string_view text) {
+    const std::size_t room = kLogMessageCapacity - length;
+    if (text.size() <= room) {
+      std::memcpy(buffer + length, text.data(), text.size());
+      length += text.size();
+      return;
+    }
+    // Truncate and mark the cut
+    std::memcpy(buffer + length, text.data(), room);
+    length = kLogMessageCapacity;
+    std::memcpy(buffer + kLogMessageCapacity - 3, "...", 3);
+  }
+
+  const LogLevel level;
+  std::size_t length = 0;
+  char buffer[kLogMessageCapacity];
+};
+
+// Sends Crow's CROW_LOG_* output through the Logger instead of std::cerr
+void route_crow_logs();
+
+#define BACKEND_LOG(level)                                          \
+  if (static_cast<int>(level) < BACKEND_LOG_MIN_LEVEL ||            \
+      !Logger::enabled(level)) {                                    \
+  } else                                                            \
+    LogLine(level)
+
+#define LOG_DEBUG BACKEND_LOG(LogLevel::kDebug)
+#define LOG_INFO BACKEND_LOG(LogLevel::kInfo)
+#define LOG_WARNING BACKEND_LOG(LogLevel::kWarning)
+#define LOG_ERROR BACKEND_LOG(LogLevel::kError)
@@ -0,0 +1,175 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Per-thread counters and HDR-style latency histograms
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Buckets of a latency histogram. Values are nanoseconds; each power of two
+// is split into kHistogramSubBuckets linear buckets, so a bucket is at most
+// 1/kHistogramSubBuckets (12.5%) wide relative to its value. The top bucket
+// starts at 2^kHistogramMaxExponent ns (about 69 s) and collects anything
+// slower.
+inline constexpr int kHistogramSubBucketBits = 3;
+inline constexpr std::size_t kHistogramSubBuckets = 1 << kHistogramSubBucketBits;
+inline constexpr int kHistogramMaxExponent = 36;
+inline constexpr std::size_t kHistogramBuckets =
+    (kHistogramMaxExponent - kHistogramSubBucketBits + 2) * kHistogramSubBuckets;
+
+// Merged view of a histogram across all threads
+struct HistogramSnapshot {
+  std::array<std::uint64_t, kHistogramBuckets> counts{};
+  std::uint64_t count = 0;
+  std::uint64_t sum_ns = 0;
+
+  // Value (ns) below which a fraction q of the samples fall, accurate to the
+  // width of one bucket. Zero when there are no samples.
+  std::uint64_t quantile(double q) const;
+
+  // The samples recorded after earlier, a snapshot of the same histogram
+  // taken before this one. Used to follow recent latency rather than the
+  // whole history.
+  HistogramSnapshot since(const HistogramSnapshot& earlier) const;
+
+  // Bucket index of a value, and the largest value a bucket holds
+  static std::size_t bucket_of(std::uint64_t ns);
+  static std::uint64_t upper_bound(std::size_t bucket);
+};
+
+// Handle to a counter. Copyable and cheap; inc() writes a cell owned by
+// the calling thread, so it never contends with other threads.
+class Counter {
+ public:
+  void inc(std::uint64_t n = 1) const;
+  std::uint64_t value() const;
+
+ private:
+  friend class MetricsRegistry;
+  explicit Counter(std::size_t cell) : cell(cell) {}
+  std::size_t cell;
+};
+
+// Handle to a latency histogram. Copyable and cheap; record() updates three
+// cells owned by the calling thread.
+class Histogram {
+ public:
+  void record(std::uint64_t ns) const;
+  void record(std::chrono::nanoseconds elapsed) const {
+    record(static_cast<std::uint64_t>(std::max<std::int64_t>(elapsed.count(), 0)));
+  }
+  HistogramSnapshot snapshot() const;
+
+ private:
+  friend class MetricsRegistry;
+  explicit Histogram(std::size_t first_cell) : first_cell(first_cell) {}
+  std::size_t first_cell;  // Buckets, then count, then sum
+};
+
+// Records the time from construction to destruction into a histogram
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(const Histogram& histogram)
+      : histogram(histogram), start(std::chrono::steady_clock::now()) {}
+  ~ScopedTimer() { histogram.record(std::chrono::steady_clock::now() - start); }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+ private:
+  const Histogram& histogram;
+  const std::chrono::steady_clock::time_point start;
+};
+
+// MetricsRegistry owns every metric of the process and renders them in the
+// Prometheus text exposition format for the /metrics route.
+//
+// Each thread that records gets its own slab of cells, aligned to a cache
+// line. Recording is a relaxed load and store on the thread's own cell: no
+// lock, no atomic read-modify-write and no sharing of cache lines between
+// threads. Readers sum the cells of every slab; slabs of exited threads
+// are folded into a retired slab so totals never go backwards.
+//
+// Register metrics at startup, before the threads that record them run;
+// registering the same name and labels again returns the same metric.
+// Gauges (queue depths, pool sizes, ...) are callbacks sampled when the
+// metrics are rendered, so they cost nothing on the hot path.
+//
+// Example usage:
+//   Histogram latency = MetricsRegistry::instance().histogram(
+//       "db_operation_duration_seconds", "Time spent in storage calls",
+//       "operation=\"create_user\"");
+//   { ScopedTimer timer(latency); db.create_user(user); }
+class MetricsRegistry {
+ public:
+  // Cells available to all metrics; a histogram uses kHistogramBuckets + 2
+  static constexpr std::size_t kMaxCells = 8192;
+
+  static MetricsRegistry& instance();
+
+  // labels is a preformatted Prometheus label list without braces, e.g.
+  // route="/login",code="2xx"
+  //
+  // Throws:
+  //   std::runtime_error: If kMaxCells would be exceeded
+  Counter counter(const std::string& name, const std::string& help,
+                  const std::string& labels = "");
+  Histogram histogram(const std::string& name, const std::string& help,
+                      const std::string& labels = "");
+  void gauge(const std::string& name, const std::string& help,
+             const std::string& labels, std::function<double()> sample);
+
+  // All metrics in the Prometheus text exposition format
+  std::string render() const;
+
+  MetricsRegistry(const MetricsRegistry&) = delete;
+  MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+ private:
+  friend class Counter;
+  friend class Histogram;
+
+  enum class Kind { kCounter, kHistogram, kGauge };
+
+  struct Metric {
+    Kind kind;
+    std::string name;
+    std::string help;
+    std::string labels;
+    std::size_t cell;                // Counters and histograms
+    std::function<double()> sample;  // Gauges
+  };
+
+  struct alignas(64) Slab {
+    std::array<std::atomic<std::uint64_t>, kMaxCells> cells{};
+  };
+
+  MetricsRegistry() = default;
+
+  // The calling thread's slab, created on first use
+  static Slab& local_slab();
+
+  // Sum of one cell over every slab. Callers hold mutex.
+  std::uint64_t sum_locked(std::size_t cell) const;
+
+  const Metric& add(Kind kind, const std::string& name, const std::string& help,
+                    const std::string& labels, std::size_t cells,
+                    std::function<double()> sample);
+
+  void retire(Slab* slab);
+
+  mutable std::mutex mutex;
+  std::vector<std::unique_ptr<Metric>> metrics;
+  std::size_t next_cell = 0;
+  std::vector<Slab*> slabs;  // Live threads
+  Slab retired;              // Totals of exited threads
+};
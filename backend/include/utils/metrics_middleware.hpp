@@ -0,0 +1,69 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Crow middleware that records per-route request metrics
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <crow.h>
+
+#include "utils/metrics.hpp"
+
+// MetricsMiddleware times every request from the moment Crow hands it to
+// the middlewares until its response is completed (for handlers that
+// answer from a worker pool, that includes the time spent there) and
+// counts responses by status class. Requests that match no route are
+// counted but not timed.
+//
+// Routes are labelled by path. Only paths registered with add_route() get
+// their own series; everything else is counted as route="other" so
+// scanners cannot create unbounded label values. A path may hold <uint>
+// segments, as in CROW_ROUTE, so "/zones/<uint>/move" is one series for
+// every zone.
+//
+// Crow hands WebSocket upgrades to the route without after_handle, so a
+// WebSocket route reports its handshake with record_upgrade() instead.
+//
+// List it first in crow::App<...> so its timer also covers the other
+// middlewares.
+struct MetricsMiddleware {
+  struct context {
+    std::chrono::steady_clock::time_point start;
+  };
+
+  MetricsMiddleware();
+
+  // Gives path its own series. Call before the server starts.
+  void add_route(const std::string& path);
+
+  void before_handle(crow::request& req, crow::response& res, context& ctx);
+  void after_handle(crow::request& req, crow::response& res, context& ctx);
+
+  // Records a WebSocket handshake as answered with code: 101 when it was
+  // accepted, or the 4xx that refused it
+  void record_upgrade(const crow::request& req, context& ctx, int code) const;
+
+ private:
+  struct RouteMetrics {
+    Histogram latency;
+    std::array<Counter, 5> responses;  // 1xx .. 5xx
+  };
+
+  static RouteMetrics make_route(const std::string& path);
+
+  // Whether url matches pattern, where <uint> stands for one or more digits
+  static bool matches(std::string_view pattern, std::string_view url);
+
+  const RouteMetrics& route_of(const std::string& url) const;
+  void record(const RouteMetrics& metrics, int code, context& ctx) const;
+
+  std::unordered_map<std::string, RouteMetrics> routes;  // Exact paths
+  std::vector<std::pair<std::string, RouteMetrics>> patterns;
+  RouteMetrics other;
+};
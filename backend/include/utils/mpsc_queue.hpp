@@ -0,0 +1,108 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Bounded lock-free queue for many producers and one consumer
+
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+// MpscQueue carries small values from any number of threads (e.g. Crow's
+// I/O threads) to one consumer (e.g. a simulation tick). It is Dmitry
+// Vyukov's bounded queue: every slot carries a sequence number that says
+// whether it is free or full, so producers claim a slot with one
+// compare-and-swap on the tail and the consumer needs no atomic
+// read-modify-write at all. Nothing is allocated after construction.
+//
+// push() fails rather than blocks when the queue is full, so a consumer
+// that falls behind sheds input instead of stalling the producers.
+//
+// Example usage:
+//   MpscQueue<Input> inputs(4096);
+//   if (!inputs.push(input)) return busy();      // any thread
+//   Input next;
+//   while (inputs.pop(next)) apply(next);         // consumer thread only
+template <typename T>
+class MpscQueue {
+ public:
+  // Capacity is rounded up to a power of two.
+  //
+  // Throws:
+  //   std::invalid_argument: If capacity is zero
+  explicit MpscQueue(std::size_t capacity) {
+    if (capacity == 0) {
+      throw std::invalid_argument("Queue capacity must be positive");
+    }
+    const std::size_t size = std::bit_ceil(capacity);
+    cells = std::make_unique<Cell[]>(size);
+    mask = size - 1;
+    for (std::size_t i = 0; i < size; ++i) {
+      cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  // Safe from any thread.
+  //
+  // Returns:
+  //   bool: false if the queue is full
+  bool push(const T& value) {
+    std::size_t position = tail.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+      cell = &cells[position & mask];
+      const std::size_t sequence =
+          cell->sequence.load(std::memory_order_acquire);
+      const auto lag = static_cast<std::intptr_t>(sequence) -
+                       static_cast<std::intptr_t>(position);
+      if (lag == 0) {
+        // Free for this lap; claim it unless another producer got there
+        if (tail.compare_exchange_weak(position, position + 1,
+                                       std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (lag < 0) {
+        return false;  // Still holds last lap's value: full
+      } else {
+        position = tail.load(std::memory_order_relaxed);
+      }
+    }
+    cell->value = value;
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Called by the consumer thread only.
+  //
+  // Returns:
+  //   bool: false if the queue is empty, or the next value is still
+  //     being written
+  bool pop(T& out) {
+    Cell& cell = cells[head & mask];
+    if (cell.sequence.load(std::memory_order_acquire) != head + 1) {
+      return false;
+    }
+    out = cell.value;
+    cell.sequence.store(head + mask + 1, std::memory_order_release);
+    ++head;
+    return true;
+  }
+
+  std::size_t capacity() const { return mask + 1; }
+
+ private:
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+
+  std::unique_ptr<Cell[]> cells;
+  std::size_t mask;
+  alignas(64) std::atomic<std::size_t> tail{0};  // Next slot to claim
+  alignas(64) std::size_t head = 0;  // Next slot to read; consumer only
+};
@@ -0,0 +1,52 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Salted PBKDF2 password hashing
+
+#pragma once
+
+#include <string>
+
+// Prefix of every hash produced by PasswordHasher
+inline constexpr char kPasswordHashScheme[] = "pbkdf2_sha256";
+
+// PasswordHasher derives salted PBKDF2-HMAC-SHA256 hashes through OpenSSL.
+// Hashes are stored as "pbkdf2_sha256$<iterations>$<salt hex>$<key hex>",
+// so the cost can be raised later without invalidating existing rows: each
+// hash is verified with the iteration count it was created with.
+//
+// Hashing is deliberately slow (the cost is the iteration count) and must
+// run on the hashing WorkerPool, never on one of Crow's I/O threads. The
+// class holds no mutable state, so one instance is shared by every worker.
+//
+// Example usage:
+//   PasswordHasher hasher(310000);
+//   std::string stored = hasher.hash("pikachu12");
+//   bool ok = hasher.verify("pikachu12", stored);
+class PasswordHasher {
+ public:
+  // A cost below one iteration is raised to one.
+  explicit PasswordHasher(int iterations);
+
+  // Returns the encoded hash of password with a fresh random salt.
+  //
+  // Throws:
+  //   std::runtime_error: If OpenSSL fails to produce a salt or key
+  std::string hash(const std::string& password) const;
+
+  // Checks password against a value produced by hash(). Rows written
+  // before hashing was introduced hold the plain password; those are
+  // compared directly (in constant time).
+  bool verify(const std::string& password, const std::string& stored) const;
+
+  // Spends the same time as verifying a real hash and returns false. Used
+  // for unknown usernames so response times do not reveal which names
+  // exist.
+  bool reject(const std::string& password) const;
+
+  int iterations() const { return cost; }
+
+ private:
+  const int cost;
+
+  // Hash of a random password, compared against by reject()
+  const std::string decoy;
+};
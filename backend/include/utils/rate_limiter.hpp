@@ -0,0 +1,88 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Fixed-memory table of token buckets
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// Refill rate and size of one token bucket. A rate of zero disables it.
+struct BucketLimit {
+  double per_second;
+  double burst;
+
+  bool enabled() const { return per_second > 0 && burst > 0; }
+};
+
+// Counters reported by RateLimiter::stats()
+struct RateLimiterStats {
+  std::size_t capacity;     // Buckets the table can hold
+  std::uint64_t allowed;    // acquire() calls that got a token
+  std::uint64_t limited;    // acquire() calls that were refused
+  std::uint64_t evictions;  // Buckets dropped to make room for new keys
+};
+
+// RateLimiter keeps one token bucket per key (an IP address, a username,
+// ...) in a table whose memory is fixed when it is created, so a flood of
+// distinct keys cannot grow it.
+//
+// The table is split into shards, each with its own mutex, and each shard
+// into small sets of kWays buckets picked by the key's hash. A new key
+// takes a free bucket in its set or evicts the one used least recently,
+// which approximates LRU over the whole table. Keys are identified by a
+// 64-bit hash, so two keys can in principle share a bucket; at the table
+// sizes used here that is vanishingly rare and only makes a limit stricter.
+//
+// Example usage:
+//   RateLimiter limiter(65536);
+//   auto wait = limiter.acquire("login|ip|10.0.0.1", {0.5, 10});
+//   if (wait.count() > 0) { reject, retry after `wait` }
+class RateLimiter {
+ public:
+  static constexpr std::size_t kWays = 4;
+
+  // capacity is the total number of buckets; it is rounded up so every
+  // shard holds whole sets.
+  explicit RateLimiter(std::size_t capacity);
+
+  RateLimiter(const RateLimiter&) = delete;
+  RateLimiter& operator=(const RateLimiter&) = delete;
+
+  // Takes one token from key's bucket. Returns zero when the call is
+  // allowed, otherwise how long until a token will be available.
+  std::chrono::milliseconds acquire(std::string_view key,
+                                    const BucketLimit& limit);
+
+  RateLimiterStats stats() const;
+
+ private:
+  static constexpr std::size_t kShards = 64;
+
+  // 16 bytes per bucket
+  struct Bucket {
+    std::uint64_t key = 0;  // Hash of the key; 0 marks a free bucket
+    float tokens = 0;
+    std::uint32_t updated_ms = 0;  // Last refill, in ms since construction
+  };
+
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    std::vector<Bucket> buckets;
+  };
+
+  std::uint32_t now_ms() const;
+
+  const std::chrono::steady_clock::time_point started;
+  std::size_t sets_per_shard;
+  std::unique_ptr<Shard[]> shards;
+
+  std::atomic<std::uint64_t> allowed{0};
+  std::atomic<std::uint64_t> limited{0};
+  std::atomic<std::uint64_t> evictions{0};
+};
@@ -0,0 +1,205 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Compile-time request schemas filled by a single-pass JSON parser
+
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// JsonScanner reads JSON tokens from left to right without building a
+// document. Strings without escapes are returned as views into the input;
+// the others are decoded into a caller-provided buffer.
+class JsonScanner {
+ public:
+  explicit JsonScanner(std::string_view text) : text(text) {}
+
+  // Skips whitespace, then consumes c if it is next
+  bool consume(char c);
+
+  // Skips whitespace and peeks at the next character, or '\0' at the end
+  char peek();
+
+  // Whether only whitespace is left
+  bool at_end();
+
+  // Reads a string. Escaped strings are decoded into decoded, which must
+  // start out empty for each input. It is reserved to the input size on
+  // first use so earlier views into it stay valid: decoding never produces
+  // more bytes than it consumes.
+  bool read_string(std::string_view& out, std::string& decoded);
+
+  // Reads an integer that fits in 64 bits (no fraction or exponent)
+  bool read_integer(std::int64_t& out);
+
+  bool read_bool(bool& out);
+
+  // Skips any value, nested objects and arrays included, checking that it
+  // is well formed
+  bool skip_value();
+
+ private:
+  // Nesting deeper than this is rejected rather than risking the stack
+  static constexpr int kMaxDepth = 32;
+
+  void skip_whitespace();
+  bool skip_string();
+  bool skip_number();
+  bool skip_literal(std::string_view literal);
+  bool skip_value(int depth);
+
+  std::string_view text;
+  std::size_t pos = 0;
+};
+
+// One member of a request schema: its JSON name, the struct member it
+// fills and whether a request without it is rejected
+template <typename Request, typename Member>
+struct SchemaField {
+  std::string_view name;
+  Member Request::*member;
+  bool required;
+};
+
+template <typename Request, typename Member>
+constexpr SchemaField<Request, Member> required_field(
+    std::string_view name, Member Request::*member) {
+  return {name, member, true};
+}
+
+template <typename Request, typename Member>
+constexpr SchemaField<Request, Member> optional_field(
+    std::string_view name, Member Request::*member) {
+  return {name, member, false};
+}
+
+enum class ParseStatus {
+  kOk,
+  kMalformed,     // Not a JSON object, or a field has the wrong type
+  kMissingField,  // A required field is absent
+};
+
+namespace request_schema_detail {
+
+enum class ReadResult { kRead, kWrongType, kSyntaxError };
+
+// Reads the next value into a member of one of the supported types,
+// skipping it if it holds another JSON type
+template <typename Member>
+ReadResult read_member(JsonScanner& in, Member& member, std::string& decoded) {
+  const char next = in.peek();
+  bool ok;
+  if constexpr (std::same_as<Member, std::string_view>) {
+    if (next != '"') return in.skip_value() ? ReadResult::kWrongType
+                                            : ReadResult::kSyntaxError;
+    ok = in.read_string(member, decoded);
+  } else if constexpr (std::same_as<Member, std::string>) {
+    if (next != '"') return in.skip_value() ? ReadResult::kWrongType
+                                            : ReadResult::kSyntaxError;
+    std::string_view text;
+    ok = in.read_string(text, decoded);
+    member.assign(text);
+  } else if constexpr (std::same_as<Member, bool>) {
+    if (next != 't' && next != 'f') {
+      return in.skip_value() ? ReadResult::kWrongType
+                             : ReadResult::kSyntaxError;
+    }
+    ok = in.read_bool(member);
+  } else {
+    static_assert(std::same_as<Member, std::int64_t>,
+                  "Schema fields must be string_view, string, bool or int64_t");
+    if (next != '-' && (next < '0' || next > '9')) {
+      return in.skip_value() ? ReadResult::kWrongType
+                             : ReadResult::kSyntaxError;
+    }
+    ok = in.read_integer(member);
+  }
+  return ok ? ReadResult::kRead : ReadResult::kSyntaxError;
+}
+
+}  // namespace request_schema_detail
+
+// Fills request from a JSON object in one pass over body, using the
+// schema declared as Request::kSchema, a tuple of fields:
+//
+//   struct LoginRequest {
+//     std::string_view username;
+//     std::string_view password;
+//
+//     static constexpr auto kSchema = std::make_tuple(
+//         required_field("username", &LoginRequest::username),
+//         required_field("password", &LoginRequest::password));
+//   };
+//
+//   LoginRequest login;
+//   std::string decoded;
+//   if (parse_request(req.body, login, decoded) != ParseStatus::kOk) ...
+//
+// string_view members point into body, or into decoded for strings with
+// escapes, so both must outlive request. Members not in the schema are
+// skipped; a repeated member keeps its last value. A missing required
+// field is reported before a field of the wrong type, as the handlers
+// used to check presence first.
+template <typename Request>
+ParseStatus parse_request(std::string_view body, Request& request,
+                          std::string& decoded) {
+  using request_schema_detail::ReadResult;
+  constexpr auto& schema = Request::kSchema;
+  constexpr std::size_t kFields = std::tuple_size_v<
+      std::remove_cvref_t<decltype(schema)>>;
+  static_assert(kFields <= 64, "Too many fields in request schema");
+
+  JsonScanner in(body);
+  std::uint64_t seen = 0;  // Present, whether or not of the right type
+  bool wrong_type = false;
+
+  if (!in.consume('{')) return ParseStatus::kMalformed;
+  if (!in.consume('}')) {
+    do {
+      std::string_view key;
+      if (in.peek() != '"' || !in.read_string(key, decoded) ||
+          !in.consume(':')) {
+        return ParseStatus::kMalformed;
+      }
+
+      // The field list is known at compile time, so this unrolls into one
+      // comparison per field
+      ReadResult result = ReadResult::kSyntaxError;
+      bool matched = false;
+      auto try_field = [&]<std::size_t I>() {
+        const auto& field = std::get<I>(schema);
+        if (matched || key != field.name) return;
+        matched = true;
+        seen |= std::uint64_t{1} << I;
+        result = request_schema_detail::read_member(
+            in, request.*field.member, decoded);
+      };
+      [&]<std::size_t... I>(std::index_sequence<I...>) {
+        (try_field.template operator()<I>(), ...);
+      }(std::make_index_sequence<kFields>());
+
+      if (!matched) {
+        if (!in.skip_value()) return ParseStatus::kMalformed;
+        continue;
+      }
+      if (result == ReadResult::kSyntaxError) return ParseStatus::kMalformed;
+      if (result == ReadResult::kWrongType) wrong_type = true;
+    } while (in.consume(','));
+    if (!in.consume('}')) return ParseStatus::kMalformed;
+  }
+  if (!in.at_end()) return ParseStatus::kMalformed;
+
+  std::uint64_t required = 0;
+  [&]<std::size_t... I>(std::index_sequence<I...>) {
+    ((required |= std::get<I>(schema).required ? std::uint64_t{1} << I : 0),
+     ...);
+  }(std::make_index_sequence<kFields>());
+
+  if ((seen & required) != required) return ParseStatus::kMissingField;
+  return wrong_type ? ParseStatus::kMalformed : ParseStatus::kOk;
+}
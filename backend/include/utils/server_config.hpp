@@ -0,0 +1,74 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// HTTP server settings: port, threads, CPU affinity and listener options
+
+#pragma once
+#include "utils/cpu_affinity.hpp"
+#include "utils/env.hpp"
+#include "utils/logger.hpp"
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ServerConfig {
+    // Reads a whole number between 0 and max. These settings are read once
+    // the rest of the server is built, so a malformed value falls back to
+    // the default with a warning instead of throwing out of main.
+    static std::uint64_t number(const std::string& name,
+                                std::uint64_t fallback,
+                                std::uint64_t max = UINT64_MAX) {
+        const std::string text = EnvLoader::getEnvVariable(name, "");
+        if (text.empty()) return fallback;
+        std::uint64_t value = 0;
+        const auto [end, error] =
+            std::from_chars(text.data(), text.data() + text.size(), value);
+        if (error != std::errc() || end != text.data() + text.size() ||
+            value > max) {
+            LOG_WARNING << name << "=" << text << " is not valid; using "
+                        << fallback;
+            return fallback;
+        }
+        return value;
+    }
+
+    // Port the HTTP server listens on.
+    const std::uint16_t port =
+        static_cast<std::uint16_t>(number("SERVER_PORT", 3000, UINT16_MAX));
+
+    // Crow threads: one accepts connections and the others serve them.
+    // Defaults to one per core; Crow runs at least two.
+    const std::uint16_t threads = static_cast<std::uint16_t>(number(
+        "SERVER_THREADS", std::thread::hardware_concurrency(), UINT16_MAX));
+
+    // Cores the Crow threads may run on, e.g. "0-3"; empty means any core.
+    // Keeps request handling off cores reserved for other work such as the
+    // game simulation. A malformed list means any core, with a warning.
+    const std::vector<int> cpus = [] {
+        const std::string list = EnvLoader::getEnvVariable("SERVER_CPUS", "");
+        try {
+            return parse_cpu_list(list);
+        } catch (const std::invalid_argument& e) {
+            LOG_WARNING << "SERVER_CPUS=" << list << " is not valid ("
+                        << e.what() << "); using any core";
+            return std::vector<int>();
+        }
+    }();
+
+    // Pin each I/O thread to a single core of cpus, taken in turn, instead
+    // of letting the threads move between them.
+    const bool pin_threads =
+        EnvLoader::getEnvVariable("SERVER_PIN_THREADS", "0") == "1";
+
+    // Listen with SO_REUSEPORT, so several backend processes can serve the
+    // same port and the kernel spreads new connections across them.
+    const bool reuse_port =
+        EnvLoader::getEnvVariable("SERVER_REUSE_PORT", "0") == "1";
+
+    // How long a graceful shutdown waits for in-flight requests before
+    // stopping anyway.
+    const std::chrono::milliseconds drain_timeout{
+        number("DRAIN_TIMEOUT_MS", 30000, 24 * 60 * 60 * 1000)};
+};
@@ -0,0 +1,69 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Fixed-rate tick loop on a dedicated thread
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "utils/metrics.hpp"
+
+struct TickSchedulerStats {
+  std::uint64_t ticks;     // Ticks run
+  std::uint64_t overruns;  // Ticks that took longer than the period
+  std::uint64_t skipped;   // Ticks dropped to catch up after falling behind
+};
+
+// TickScheduler calls a function at a fixed rate on its own thread, for
+// simulation work such as the spawn engine that must not share Crow's I/O
+// threads. Ticks are scheduled against the start time, not the end of the
+// previous tick, so they do not drift. A tick that runs late is started
+// at once. Ticks missed entirely are skipped rather than run back to back.
+//
+// Each tick's duration is recorded in tick_duration_seconds{loop=name}.
+//
+// Example usage:
+//   TickScheduler spawns("spawn", std::chrono::seconds(1),
+//                        [&engine] { engine.tick(); });
+class TickScheduler {
+ public:
+  // Starts the thread. The first tick runs one period from now.
+  TickScheduler(std::string name, std::chrono::milliseconds period,
+                std::function<void()> tick);
+
+  // Stops the loop; see stop()
+  ~TickScheduler();
+
+  TickScheduler(const TickScheduler&) = delete;
+  TickScheduler& operator=(const TickScheduler&) = delete;
+
+  // Waits for the running tick, if any, then joins the thread. Safe to
+  // call more than once.
+  void stop();
+
+  TickSchedulerStats stats() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  void run();
+
+  const std::string name;
+  const Clock::duration period;
+  const std::function<void()> tick;
+  const Histogram duration;  // tick_duration_seconds{loop=name}
+
+  mutable std::mutex mutex;
+  std::condition_variable wake;
+  bool stopping = false;
+  std::uint64_t ticks = 0;
+  std::uint64_t overruns = 0;
+  std::uint64_t skipped = 0;
+
+  std::thread thread;
+};
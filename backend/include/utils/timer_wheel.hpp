@@ -0,0 +1,80 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Hierarchical timer wheel for cheap bulk expiry
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Intrusive hook for objects scheduled on a TimerWheel. Embed it (or
+// inherit from it) in the object that expires; the wheel never allocates.
+struct TimerNode {
+  std::uint64_t deadline = 0;  // Tick at which the node expires
+  TimerNode* prev = nullptr;
+  TimerNode* next = nullptr;
+
+  bool scheduled() const { return prev != nullptr; }
+};
+
+// TimerWheel tracks deadlines in four levels of 64 slots. Level 0 holds
+// the next 64 ticks one slot per tick; each higher level covers 64 times
+// the span of the one below, for about 16.7 million ticks in total (194
+// days at one tick per second). Deadlines further out wait in the top
+// level and are rescheduled when they come around.
+//
+// schedule() and cancel() are O(1). advance() visits only the nodes whose
+// slot comes due, and a node moves down at most three times before it
+// fires, so expiring many entries never means scanning all of them.
+//
+// Not thread-safe: each owner (e.g. a SessionStore shard) guards its wheel
+// with its own lock.
+//
+// Example usage:
+//   TimerWheel wheel;
+//   wheel.schedule(&entry.timer, wheel.now() + 30);
+//   wheel.advance(wheel.now() + 1, [](TimerNode* node) { expire(node); });
+class TimerWheel {
+ public:
+  static constexpr int kLevels = 4;
+  static constexpr int kSlotBits = 6;
+  static constexpr std::size_t kSlots = std::size_t{1} << kSlotBits;
+
+  TimerWheel();
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  // Current tick; deadlines are absolute ticks
+  std::uint64_t now() const { return current; }
+
+  // Number of scheduled nodes
+  std::size_t size() const { return count; }
+
+  // Schedules node to fire at deadline, moving it if it was already
+  // scheduled. Deadlines at or before now() fire on the next tick.
+  void schedule(TimerNode* node, std::uint64_t deadline);
+
+  // Unschedules node; does nothing if it is not scheduled
+  void cancel(TimerNode* node);
+
+  // Moves the wheel forward to tick `to`, calling expired(node) for every
+  // node whose deadline has passed. The node is already unscheduled when
+  // the callback runs, so the callback may free or reschedule it.
+  void advance(std::uint64_t to, const std::function<void(TimerNode*)>& expired);
+
+ private:
+  // Circular list head; an empty slot points at itself
+  using Slot = TimerNode;
+
+  void link(Slot& slot, TimerNode* node);
+  Slot& slot_for(std::uint64_t deadline);
+
+  // Re-inserts every node of slot, which moves them to lower levels
+  void cascade(Slot& slot);
+
+  std::array<std::array<Slot, kSlots>, kLevels> levels;
+  std::uint64_t current = 0;
+  std::size_t count = 0;
+};
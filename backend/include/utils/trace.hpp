@@ -0,0 +1,172 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Per-request stage timing and sampled export of request traces
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+// One timed stage of a request, relative to the start of its trace
+struct TraceSpan {
+  const char* name;  // Must outlive the trace, e.g. a string literal
+  std::chrono::nanoseconds start;
+  std::chrono::nanoseconds duration;
+};
+
+// Trace collects the stages (spans) of one request. A request only ever
+// runs on one thread at a time: the I/O thread, then the worker pools it
+// is handed to, through their queues. Spans are therefore added without
+// locking, but every span must end before the request's response is sent.
+//
+// Code does not pass traces around: each thread has a current trace, set
+// with ActiveTrace, and StageTimer records into it. WorkerPool carries the
+// current trace over to the tasks submitted from it.
+class Trace : public std::enable_shared_from_this<Trace> {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // Spans past this are counted in dropped_spans() but not kept
+  static constexpr std::size_t kMaxSpans = 24;
+
+  explicit Trace(std::string request_id);
+
+  void add(const char* name, Clock::time_point from, Clock::time_point to);
+
+  const std::string& request_id() const { return id; }
+  Clock::time_point started() const { return start; }
+  std::chrono::system_clock::time_point started_wall() const {
+    return wall_start;
+  }
+  const TraceSpan* begin() const { return spans.data(); }
+  const TraceSpan* end() const { return spans.data() + span_count; }
+  std::size_t dropped_spans() const { return dropped; }
+
+  // The calling thread's current trace, or nullptr
+  static Trace* current() { return active; }
+
+ private:
+  friend class ActiveTrace;
+
+  static inline thread_local Trace* active = nullptr;
+
+  const std::string id;
+  const Clock::time_point start;
+  const std::chrono::system_clock::time_point wall_start;
+  std::array<TraceSpan, kMaxSpans> spans;
+  std::size_t span_count = 0;
+  std::size_t dropped = 0;
+};
+
+// Makes a trace the calling thread's current one for the lifetime of the
+// guard, and keeps it alive that long: a handler's response may complete,
+// and the middleware release the trace, while the handler is still in
+// scope. A null trace turns stage timing off for the scope.
+class ActiveTrace {
+ public:
+  explicit ActiveTrace(std::shared_ptr<Trace> trace)
+      : trace(std::move(trace)), previous(Trace::active) {
+    Trace::active = this->trace.get();
+  }
+  ~ActiveTrace() { Trace::active = previous; }
+
+  ActiveTrace(const ActiveTrace&) = delete;
+  ActiveTrace& operator=(const ActiveTrace&) = delete;
+
+ private:
+  const std::shared_ptr<Trace> trace;
+  Trace* const previous;
+};
+
+// Records the time from construction to destruction as a span of the
+// current trace. Costs a thread-local read when there is none.
+//
+// Example usage:
+//   {
+//     StageTimer stage("parse");
+//     body = crow::json::load(req.body);
+//   }
+class StageTimer {
+ public:
+  explicit StageTimer(const char* name) : trace(Trace::current()), name(name) {
+    if (trace) start = Trace::Clock::now();
+  }
+  ~StageTimer() {
+    if (trace) trace->add(name, start, Trace::Clock::now());
+  }
+
+  StageTimer(const StageTimer&) = delete;
+  StageTimer& operator=(const StageTimer&) = delete;
+
+ private:
+  Trace* const trace;
+  const char* const name;
+  Trace::Clock::time_point start;
+};
+
+struct TraceExporterStats {
+  std::uint64_t exported;  // Traces written to the file
+  std::uint64_t dropped;   // Traces lost because the writer fell behind
+};
+
+// TraceExporter appends finished traces to a file, one JSON object per
+// line. It keeps a random sample of requests plus every request slower
+// than the slow threshold, so tail latency is always explained. A
+// background thread does the writing; finish() only formats the line and
+// queues it.
+//
+// Example line:
+//   {"requestId":"5f1c9a2e00000007","method":"POST","route":"/signup",
+//    "status":201,"timestamp":1718000000123456,"durationNs":104312000,
+//    "spans":[{"name":"parse","startNs":2100,"durationNs":5300},...]}
+class TraceExporter {
+ public:
+  // sample_rate is the fraction of requests kept regardless of latency.
+  //
+  // Throws:
+  //   std::runtime_error: If path cannot be opened for appending
+  TraceExporter(const std::string& path, double sample_rate,
+                std::chrono::milliseconds slow_threshold);
+
+  // Writes the traces still queued, then stops the writer thread.
+  ~TraceExporter();
+
+  TraceExporter(const TraceExporter&) = delete;
+  TraceExporter& operator=(const TraceExporter&) = delete;
+
+  // Queues trace for export if it is sampled or slow. Call once the
+  // response is complete; never blocks on the file.
+  void finish(const Trace& trace, std::string_view method,
+              std::string_view route, int status);
+
+  TraceExporterStats stats() const;
+
+ private:
+  // Lines waiting for the writer; more are dropped rather than queued
+  static constexpr std::size_t kMaxPending = 4096;
+
+  void run();
+
+  std::ofstream file;
+  const double sample_rate;
+  const std::chrono::nanoseconds slow_threshold;
+
+  mutable std::mutex mutex;
+  std::condition_variable wake;
+  std::deque<std::string> pending;
+  bool stopping = false;
+  std::uint64_t exported = 0;
+  std::uint64_t dropped = 0;
+
+  std::thread writer;
+};
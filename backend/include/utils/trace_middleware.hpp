@@ -0,0 +1,43 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Crow middleware that assigns request ids and exports request traces
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <crow.h>
+
+#include "utils/trace.hpp"
+
+// TraceMiddleware gives every request an id, echoed in the X-Request-Id
+// response header. A well-formed X-Request-Id sent by the client (or a
+// proxy in front of the server) is kept so logs can be joined across
+// services.
+//
+// When an exporter is set, each request also gets a Trace. Handlers make
+// it current with
+//   ActiveTrace active(app.get_context<TraceMiddleware>(req).trace);
+// and the trace is handed to the exporter once the response is complete.
+struct TraceMiddleware {
+  struct context {
+    std::string request_id;
+    std::shared_ptr<Trace> trace;
+  };
+
+  TraceMiddleware();
+
+  // Where finished traces go; nullptr (the default) disables tracing
+  TraceExporter* exporter = nullptr;
+
+  void before_handle(crow::request& req, crow::response& res, context& ctx);
+  void after_handle(crow::request& req, crow::response& res, context& ctx);
+
+ private:
+  std::string next_id();
+
+  const std::uint32_t id_prefix;  // Random per process
+  std::atomic<std::uint32_t> id_counter{0};
+};
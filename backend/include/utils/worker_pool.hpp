@@ -0,0 +1,120 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Fixed-size thread pool with a bounded submission queue
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils/metrics.hpp"
+#include "utils/trace.hpp"
+
+// Snapshot of a WorkerPool's counters, used to size its threads and queue.
+struct WorkerPoolStats {
+  std::size_t threads;         // Worker threads
+  std::size_t queue_capacity;  // Maximum queued tasks
+  std::size_t queue_depth;     // Tasks currently waiting for a worker
+  std::size_t peak_queue_depth;
+  std::size_t active;          // Tasks currently running
+  std::uint64_t submitted;     // Tasks accepted
+  std::uint64_t rejected;      // Tasks refused because the queue was full
+  std::uint64_t completed;     // Tasks finished
+  std::uint64_t dropped;       // Tasks discarded by a shutdown deadline
+  std::uint64_t total_wait_us;  // Sum of queue wait across completed tasks
+  std::uint64_t max_wait_us;    // Longest queue wait observed
+};
+
+// WorkerPool runs blocking work (MySQL queries, hashing) off Crow's I/O
+// threads. Tasks wait in a bounded FIFO queue; when the queue is full,
+// try_submit refuses the task so the caller can shed load instead of
+// queueing without limit.
+//
+// Tasks report their result through whatever callback they capture. The
+// HTTP handlers post the result back to the request's io_service so the
+// response is always completed on the connection's own thread.
+//
+// A task submitted while a Trace is current runs with that trace current
+// too, and its time in the queue is recorded as a "<name>.queue" span.
+//
+// Example usage:
+//   WorkerPool pool("db", 8, 1024);
+//   if (!pool.try_submit([] { run_query(); })) {
+//     Queue full
+//   }
+class WorkerPool {
+ public:
+  using Task = std::function<void()>;
+  using Clock = std::chrono::steady_clock;
+
+  // Starts the worker threads. A thread count of zero is raised to one.
+  WorkerPool(std::string name, std::size_t threads,
+             std::size_t queue_capacity);
+
+  // Runs every task already queued, then joins the workers.
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  // Queues task for execution.
+  //
+  // Returns:
+  //   bool: false if the queue is full or the pool is shutting down
+  bool try_submit(Task task);
+
+  // Stops accepting tasks, finishes the queued ones and joins the workers.
+  // Safe to call more than once.
+  void shutdown() { shutdown(Clock::time_point::max()); }
+
+  // Like shutdown(), but tasks still queued at the deadline are dropped
+  // without running. Running tasks always finish.
+  void shutdown(std::chrono::steady_clock::time_point deadline);
+
+  WorkerPoolStats stats() const;
+
+  const std::string& name() const { return pool_name; }
+
+  // Time from submission until each task finished, queue wait included
+  const Histogram& latency() const { return task_latency; }
+
+ private:
+  struct QueuedTask {
+    Task task;
+    Clock::time_point enqueued_at;
+    std::shared_ptr<Trace> trace;
+  };
+
+  void worker_loop();
+
+  const std::string pool_name;
+  const std::size_t queue_capacity;
+  const std::string queue_span;  // Span name for the queue wait
+
+  mutable std::mutex mutex;
+  std::condition_variable not_empty;
+  std::deque<QueuedTask> queue;
+  bool stopping = false;
+  Clock::time_point drop_after = Clock::time_point::max();
+
+  std::size_t peak_queue_depth = 0;
+  std::size_t active = 0;
+  std::uint64_t submitted = 0;
+  std::uint64_t rejected = 0;
+  std::uint64_t completed = 0;
+  std::uint64_t dropped = 0;
+  std::uint64_t total_wait_us = 0;
+  std::uint64_t max_wait_us = 0;
+  const Histogram queue_wait;  // executor_queue_wait_seconds{pool=name}
+  const Histogram task_latency;  // executor_task_duration_seconds{pool=name}
+
+  std::vector<std::thread> workers;
+};
@@ -0,0 +1,106 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the rate limiting middleware
+
+#include "auth/rate_limit_middleware.hpp"
+#include <algorithm>
+#include <string_view>
+
+#include "models/api_response.hpp"
+#include "utils/request_schema.hpp"
+#include "utils/env.hpp"
+#include "utils/fold_case.hpp"
+
+namespace {
+
+// The only field the limiter needs from /login and /signup bodies
+struct UsernameField {
+  std::string_view username;
+
+  static constexpr auto kSchema = std::make_tuple(
+      optional_field("username", &UsernameField::username));
+};
+
+BucketLimit bucket_from_env(const std::string& prefix,
+                            const BucketLimit& defaults) {
+  const double per_minute = std::stod(EnvLoader::getEnvVariable(
+      prefix + "_PER_MINUTE", std::to_string(defaults.per_second * 60)));
+  const double burst = std::stod(EnvLoader::getEnvVariable(
+      prefix + "_BURST", std::to_string(defaults.burst)));
+  return {per_minute / 60, burst};
+}
+
+// Address the request came from. Behind a trusted proxy that is the first
+// entry of X-Forwarded-For rather than the proxy itself.
+std::string client_address(const crow::request& req, bool trust_forwarded) {
+  if (trust_forwarded) {
+    const std::string& forwarded = req.get_header_value("X-Forwarded-For");
+    if (!forwarded.empty()) {
+      std::string_view first = std::string_view(forwarded).substr(
+          0, forwarded.find(','));
+      while (!first.empty() && first.front() == ' ') first.remove_prefix(1);
+      while (!first.empty() && first.back() == ' ') first.remove_suffix(1);
+      if (!first.empty()) return std::string(first);
+    }
+  }
+  return req.remote_ip_address;
+}
+
+}  // namespace
+
+RouteLimits RouteLimits::from_env(const std::string& route,
+                                  const RouteLimits& defaults) {
+  const std::string prefix = "RATE_LIMIT_" + route;
+  return {bucket_from_env(prefix + "_IP", defaults.per_ip),
+          bucket_from_env(prefix + "_USER", defaults.per_username)};
+}
+
+void RateLimitMiddleware::configure(std::size_t capacity,
+                                    bool trust_forwarded_for) {
+  limiter = std::make_unique<RateLimiter>(capacity);
+  trust_forwarded = trust_forwarded_for;
+}
+
+void RateLimitMiddleware::limit(const std::string& path, RouteLimits limits) {
+  routes[path] = limits;
+}
+
+RateLimiterStats RateLimitMiddleware::stats() const {
+  return limiter ? limiter->stats() : RateLimiterStats{};
+}
+
+void RateLimitMiddleware::before_handle(crow::request& req,
+                                        crow::response& res, context&) {
+  auto route = routes.find(req.url);
+  if (!limiter || route == routes.end()) return;
+  const RouteLimits& limits = route->second;
+
+  // Bucket keys are "<path>|ip|<address>" and "<path>|user|<username>",
+  // with the username case-folded like the users table compares it, so
+  // each route counts separately and "Ash" and "ASH" share a bucket
+  std::chrono::milliseconds wait(0);
+  if (limits.per_ip.enabled()) {
+    wait = limiter->acquire(
+        req.url + "|ip|" + client_address(req, trust_forwarded), limits.per_ip);
+  }
+
+  if (wait.count() == 0 && limits.per_username.enabled()) {
+    // The handler validates the body; here a missing or malformed username
+    // simply skips the per-username bucket
+    UsernameField body;
+    std::string decoded;
+    if (parse_request(req.body, body, decoded) == ParseStatus::kOk &&
+        !body.username.empty()) {
+      wait = limiter->acquire(req.url + "|user|" + fold_case(body.username),
+                              limits.per_username);
+    }
+  }
+
+  if (wait.count() == 0) return;
+
+  res = responses::kTooManyRequests.ToResponse();
+  // Whole seconds, rounded up
+  res.set_header("Retry-After",
+                 std::to_string(std::max<std::int64_t>(
+                     (wait.count() + 999) / 1000, 1)));
+  res.end();
+}
@@ -0,0 +1,228 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the sharded session store
+
+#include "auth/session_store.hpp"
+#include <openssl/rand.h>
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <stdexcept>
+
+#include "utils/logger.hpp"
+
+namespace {
+
+constexpr std::size_t kIdBytes = 16;
+
+// Heap bytes owned by a string, beyond the object itself
+std::size_t heap_bytes(const std::string& text) {
+  // Short strings live inside the object (small string optimization)
+  return text.capacity() > std::string().capacity() ? text.capacity() + 1 : 0;
+}
+
+std::string random_id() {
+  std::array<unsigned char, kIdBytes> bytes;
+  if (RAND_bytes(bytes.data(), bytes.size()) != 1) {
+    throw std::runtime_error("Could not generate a session id");
+  }
+
+  static constexpr char kDigits[] = "0123456789abcdef";
+  std::string id(kIdBytes * 2, '0');
+  for (std::size_t i = 0; i < kIdBytes; ++i) {
+    id[2 * i] = kDigits[bytes[i] >> 4];
+    id[2 * i + 1] = kDigits[bytes[i] & 0x0f];
+  }
+  return id;
+}
+
+}  // namespace
+
+SessionStore::SessionStore(std::size_t shard_count,
+                           std::chrono::seconds idle_timeout)
+    : timeout_ticks(std::max<std::int64_t>(idle_timeout.count(), 1)),
+      started(Clock::now()),
+      started_unix(std::chrono::duration_cast<std::chrono::seconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count()) {
+  shards.resize(std::max<std::size_t>(shard_count, 1));
+  for (auto& shard : shards) shard = std::make_unique<Shard>();
+  reaper = std::thread([this] { reap_loop(); });
+}
+
+SessionStore::~SessionStore() {
+  {
+    std::lock_guard<std::mutex> lock(reaper_mutex);
+    stopping = true;
+  }
+  reaper_wake.notify_one();
+  reaper.join();
+}
+
+SessionStore::Shard& SessionStore::shard_of(const std::string& id) const {
+  return *shards[std::hash<std::string>{}(id) % shards.size()];
+}
+
+std::uint64_t SessionStore::now_tick() const {
+  return std::chrono::duration_cast<std::chrono::seconds>(Clock::now() -
+                                                          started)
+      .count();
+}
+
+std::int64_t SessionStore::to_unix(std::uint64_t tick) const {
+  return started_unix + static_cast<std::int64_t>(tick);
+}
+
+std::string SessionStore::create(const std::string& username) {
+  std::string id = random_id();
+  Shard& shard = shard_of(id);
+  const std::uint64_t deadline = now_tick() + timeout_ticks;
+
+  std::unique_lock<std::shared_mutex> lock(shard.mutex);
+  auto [it, inserted] = shard.entries.try_emplace(id);
+  if (!inserted) {
+    // 128 random bits do not collide in practice
+    throw std::runtime_error("Session id collision");
+  }
+
+  Entry& entry = it->second;
+  entry.id = &it->first;
+  entry.username = username;
+  entry.created_at = to_unix(now_tick());
+  entry.idle_deadline.store(deadline, std::memory_order_relaxed);
+  shard.wheel.schedule(&entry, deadline);
+  shard.string_bytes += heap_bytes(it->first) + heap_bytes(entry.username);
+  lock.unlock();
+
+  created.fetch_add(1, std::memory_order_relaxed);
+  return id;
+}
+
+std::optional<Session> SessionStore::find(const std::string& id) const {
+  const Shard& shard = shard_of(id);
+  std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+  auto it = shard.entries.find(id);
+  if (it == shard.entries.end()) return std::nullopt;
+
+  // Expired sessions linger until the reaper's next tick
+  const std::uint64_t deadline =
+      it->second.idle_deadline.load(std::memory_order_relaxed);
+  if (deadline <= now_tick()) return std::nullopt;
+
+  return Session{it->second.username, it->second.created_at,
+                 to_unix(deadline),
+                 it->second.zone_ticket.load(std::memory_order_relaxed)};
+}
+
+bool SessionStore::touch(const std::string& id, const std::string& username) {
+  Shard& shard = shard_of(id);
+  std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+  auto it = shard.entries.find(id);
+  if (it == shard.entries.end() || it->second.username != username) {
+    return false;
+  }
+
+  const std::uint64_t now = now_tick();
+  std::atomic<std::uint64_t>& deadline = it->second.idle_deadline;
+  if (deadline.load(std::memory_order_relaxed) <= now) return false;
+
+  // The wheel keeps the old deadline; when it fires the reaper sees the
+  // new one and reschedules instead of expiring
+  deadline.store(now + timeout_ticks, std::memory_order_relaxed);
+  return true;
+}
+
+void SessionStore::set_zone_ticket(const std::string& id,
+                                   std::uint64_t ticket) {
+  Shard& shard = shard_of(id);
+  std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+  auto it = shard.entries.find(id);
+  if (it != shard.entries.end()) {
+    it->second.zone_ticket.store(ticket, std::memory_order_relaxed);
+  }
+}
+
+std::optional<Session> SessionStore::remove(const std::string& id,
+                                            const std::string& username) {
+  Shard& shard = shard_of(id);
+  std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+  auto it = shard.entries.find(id);
+  if (it == shard.entries.end() || it->second.username != username) {
+    return std::nullopt;
+  }
+
+  const Entry& entry = it->second;
+  Session ended{entry.username, entry.created_at,
+                to_unix(entry.idle_deadline.load(std::memory_order_relaxed)),
+                entry.zone_ticket.load(std::memory_order_relaxed)};
+  shard.wheel.cancel(&it->second);
+  shard.string_bytes -= heap_bytes(it->first) + heap_bytes(it->second.username);
+  shard.entries.erase(it);
+  lock.unlock();
+
+  removed.fetch_add(1, std::memory_order_relaxed);
+  return ended;
+}
+
+SessionStoreStats SessionStore::stats() const {
+  // A map node holds the key/value pair, the next pointer and the cached
+  // hash
+  constexpr std::size_t kNodeBytes =
+      sizeof(std::pair<const std::string, Entry>) + sizeof(void*) +
+      sizeof(std::size_t);
+
+  SessionStoreStats result{};
+  result.shards = shards.size();
+  for (const auto& shard : shards) {
+    std::shared_lock<std::shared_mutex> lock(shard->mutex);
+    result.sessions += shard->entries.size();
+    result.fixed_bytes += sizeof(Shard);
+    result.bytes += sizeof(Shard) + shard->string_bytes +
+                    shard->entries.size() * kNodeBytes +
+                    shard->entries.bucket_count() * sizeof(void*);
+  }
+  result.bytes_per_session =
+      result.sessions ? (result.bytes - result.fixed_bytes) / result.sessions
+                      : 0;
+  result.created = created.load(std::memory_order_relaxed);
+  result.expired = expired.load(std::memory_order_relaxed);
+  result.removed = removed.load(std::memory_order_relaxed);
+  return result;
+}
+
+void SessionStore::reap_loop() {
+  std::unique_lock<std::mutex> lock(reaper_mutex);
+  while (!reaper_wake.wait_for(lock, std::chrono::seconds(1),
+                               [this] { return stopping; })) {
+    lock.unlock();
+
+    const std::uint64_t now = now_tick();
+    std::uint64_t reaped = 0;
+    for (auto& shard : shards) {
+      std::unique_lock<std::shared_mutex> shard_lock(shard->mutex);
+      shard->wheel.advance(now, [&](TimerNode* node) {
+        Entry* entry = static_cast<Entry*>(node);
+        const std::uint64_t deadline =
+            entry->idle_deadline.load(std::memory_order_relaxed);
+        if (deadline > now) {
+          // Touched since it was scheduled
+          shard->wheel.schedule(node, deadline);
+          return;
+        }
+        shard->string_bytes -=
+            heap_bytes(*entry->id) + heap_bytes(entry->username);
+        shard->entries.erase(*entry->id);
+        ++reaped;
+      });
+    }
+
+    if (reaped) {
+      expired.fetch_add(reaped, std::memory_order_relaxed);
+      LOG_DEBUG << "Expired " << reaped << " sessions";
+    }
+    lock.lock();
+  }
+}
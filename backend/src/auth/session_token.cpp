@@ -0,0 +1,254 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the session token signer
+
+#include "auth/session_token.hpp"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <stdexcept>
+
+#include "utils/logger.hpp"
+
+namespace {
+
+constexpr unsigned char kTokenFormat = 2;
+
+// Format byte + key id + expiry + session id length
+constexpr std::size_t kHeaderBytes = 1 + 4 + 8 + 1;
+
+constexpr std::size_t kMacBytes = 32;
+
+// Longest username a token can carry; matches the users table column
+constexpr std::size_t kMaxUsernameBytes = 255;
+
+// Longest session id a token can carry; SessionStore ids are 32
+constexpr std::size_t kMaxSessionIdBytes = 64;
+
+constexpr std::size_t kMaxPayloadBytes =
+    kHeaderBytes + kMaxSessionIdBytes + kMaxUsernameBytes;
+
+constexpr char kBase64Url[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+void append_base64url(std::string& out, const unsigned char* data,
+                      std::size_t size) {
+  std::size_t i = 0;
+  for (; i + 3 <= size; i += 3) {
+    const std::uint32_t block = data[i] << 16 | data[i + 1] << 8 | data[i + 2];
+    out.push_back(kBase64Url[block >> 18 & 63]);
+    out.push_back(kBase64Url[block >> 12 & 63]);
+    out.push_back(kBase64Url[block >> 6 & 63]);
+    out.push_back(kBase64Url[block & 63]);
+  }
+  if (size - i == 1) {
+    const std::uint32_t block = data[i] << 16;
+    out.push_back(kBase64Url[block >> 18 & 63]);
+    out.push_back(kBase64Url[block >> 12 & 63]);
+  } else if (size - i == 2) {
+    const std::uint32_t block = data[i] << 16 | data[i + 1] << 8;
+    out.push_back(kBase64Url[block >> 18 & 63]);
+    out.push_back(kBase64Url[block >> 12 & 63]);
+    out.push_back(kBase64Url[block >> 6 & 63]);
+  }
+}
+
+int base64url_value(char c) {
+  if (c >= 'A' && c <= 'Z') return c - 'A';
+  if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+  if (c >= '0' && c <= '9') return c - '0' + 52;
+  if (c == '-') return 62;
+  if (c == '_') return 63;
+  return -1;
+}
+
+// Decodes unpadded base64url into out; returns the decoded length, or -1
+// on malformed input or if out is too small.
+template <std::size_t N>
+int decode_base64url(std::string_view text, std::array<unsigned char, N>& out) {
+  if (text.size() % 4 == 1 || text.size() * 3 / 4 > N) return -1;
+
+  std::size_t length = 0;
+  std::uint32_t block = 0;
+  int bits = 0;
+  for (char c : text) {
+    const int value = base64url_value(c);
+    if (value < 0) return -1;
+    block = block << 6 | value;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out[length++] = static_cast<unsigned char>(block >> bits);
+    }
+  }
+  return static_cast<int>(length);
+}
+
+std::int64_t now_seconds() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+void hmac(const SigningKey& key, const unsigned char* data, std::size_t size,
+          unsigned char* mac) {
+  unsigned int length = kMacBytes;
+  if (!HMAC(EVP_sha256(), key.secret.data(),
+            static_cast<int>(key.secret.size()), data, size, mac, &length)) {
+    throw std::runtime_error("Token signing failed");
+  }
+}
+
+// Parses "<id>:<secret>,<id>:<secret>,..."
+std::vector<SigningKey> parse_keys(const std::string& text) {
+  std::vector<SigningKey> keys;
+  std::string_view rest = text;
+  while (!rest.empty()) {
+    const auto comma = rest.find(',');
+    const std::string_view entry = rest.substr(0, comma);
+    rest = comma == std::string_view::npos ? std::string_view()
+                                           : rest.substr(comma + 1);
+
+    const auto colon = entry.find(':');
+    std::uint32_t id = 0;
+    if (colon == std::string_view::npos || colon + 1 == entry.size() ||
+        std::from_chars(entry.data(), entry.data() + colon, id).ptr !=
+            entry.data() + colon) {
+      throw std::runtime_error(
+          "SESSION_SIGNING_KEYS must look like <id>:<secret>,<id>:<secret>");
+    }
+    keys.push_back({id, std::string(entry.substr(colon + 1))});
+  }
+  return keys;
+}
+
+SigningKey generate_key() {
+  std::array<unsigned char, 32> secret;
+  if (RAND_bytes(secret.data(), secret.size()) != 1) {
+    throw std::runtime_error("Could not generate a session signing key");
+  }
+  return {0, std::string(secret.begin(), secret.end())};
+}
+
+}  // namespace
+
+TokenSigner::TokenSigner()
+    : lifetime(std::stol(
+          EnvLoader::getEnvVariable("SESSION_TOKEN_TTL_SECONDS", "3600"))),
+      generated_key(generate_key()) {
+  const EnvSnapshot& env = EnvLoader::snapshot();
+  std::vector<SigningKey> keys = parse_keys(env.get("SESSION_SIGNING_KEYS"));
+  if (keys.empty()) {
+    LOG_WARNING << "SESSION_SIGNING_KEYS is not set; using a random key, "
+                << "sessions will not survive a restart";
+    keys.push_back(generated_key);
+  }
+
+  rings.push_back(std::make_unique<const KeyRing>(std::move(keys),
+                                                  env.getVersion()));
+  current.store(rings.back().get(), std::memory_order_release);
+}
+
+const KeyRing& TokenSigner::ring() const {
+  const KeyRing* ring = current.load(std::memory_order_acquire);
+  const EnvSnapshot& env = EnvLoader::snapshot();
+  if (ring->version() == env.getVersion()) return *ring;
+
+  std::lock_guard<std::mutex> lock(publish_mutex);
+  ring = current.load(std::memory_order_acquire);
+  if (ring->version() == env.getVersion()) return *ring;
+
+  std::vector<SigningKey> keys;
+  try {
+    keys = parse_keys(env.get("SESSION_SIGNING_KEYS"));
+  } catch (const std::runtime_error& e) {
+    // Keep signing with the keys we have rather than failing every login
+    LOG_ERROR << "Ignoring new session keys: " << e.what();
+    keys = ring->all();
+  }
+  if (keys.empty()) keys.push_back(generated_key);
+
+  if (keys.front().id != ring->active().id) {
+    LOG_INFO << "Session tokens are now signed with key " << keys.front().id;
+  }
+  rings.push_back(std::make_unique<const KeyRing>(std::move(keys),
+                                                  env.getVersion()));
+  current.store(rings.back().get(), std::memory_order_release);
+  return *rings.back();
+}
+
+IssuedToken TokenSigner::issue(const std::string& username,
+                               const std::string& session_id) const {
+  if (username.size() > kMaxUsernameBytes) {
+    throw std::runtime_error("Username is too long for a session token");
+  }
+  if (session_id.size() > kMaxSessionIdBytes) {
+    throw std::runtime_error("Session id is too long for a session token");
+  }
+
+  const SigningKey& key = ring().active();
+  const std::int64_t expires_at = now_seconds() + lifetime.count();
+
+  std::array<unsigned char, kMaxPayloadBytes> payload;
+  payload[0] = kTokenFormat;
+  for (int i = 0; i < 4; ++i) payload[1 + i] = key.id >> (24 - 8 * i);
+  for (int i = 0; i < 8; ++i) {
+    payload[5 + i] = static_cast<std::uint64_t>(expires_at) >> (56 - 8 * i);
+  }
+  payload[13] = static_cast<unsigned char>(session_id.size());
+  auto end = std::copy(session_id.begin(), session_id.end(),
+                       payload.begin() + kHeaderBytes);
+  end = std::copy(username.begin(), username.end(), end);
+  const auto size = static_cast<std::size_t>(end - payload.begin());
+
+  std::array<unsigned char, kMacBytes> mac;
+  hmac(key, payload.data(), size, mac.data());
+
+  std::string token;
+  token.reserve((size + kMacBytes) * 4 / 3 + 4);
+  append_base64url(token, payload.data(), size);
+  token.push_back('.');
+  append_base64url(token, mac.data(), mac.size());
+  return {std::move(token), expires_at};
+}
+
+std::optional<SessionClaims> TokenSigner::verify(std::string_view token) const {
+  const auto dot = token.find('.');
+  if (dot == std::string_view::npos) return std::nullopt;
+
+  std::array<unsigned char, kMaxPayloadBytes> payload;
+  std::array<unsigned char, kMacBytes> mac;
+  const int size = decode_base64url(token.substr(0, dot), payload);
+  if (size < static_cast<int>(kHeaderBytes) || payload[0] != kTokenFormat ||
+      size < static_cast<int>(kHeaderBytes + payload[13]) ||
+      decode_base64url(token.substr(dot + 1), mac) !=
+          static_cast<int>(kMacBytes)) {
+    return std::nullopt;
+  }
+
+  std::uint32_t key_id = 0;
+  for (int i = 0; i < 4; ++i) key_id = key_id << 8 | payload[1 + i];
+  std::uint64_t expires_at = 0;
+  for (int i = 0; i < 8; ++i) expires_at = expires_at << 8 | payload[5 + i];
+
+  const SigningKey* key = ring().find(key_id);
+  if (!key) return std::nullopt;
+
+  std::array<unsigned char, kMacBytes> expected;
+  hmac(*key, payload.data(), size, expected.data());
+  if (CRYPTO_memcmp(expected.data(), mac.data(), kMacBytes) != 0) {
+    return std::nullopt;
+  }
+
+  if (static_cast<std::int64_t>(expires_at) <= now_seconds()) {
+    return std::nullopt;
+  }
+
+  const auto id_end = payload.begin() + kHeaderBytes + payload[13];
+  return SessionClaims{std::string(id_end, payload.begin() + size),
+                       std::string(payload.begin() + kHeaderBytes, id_end),
+                       static_cast<std::int64_t>(expires_at)};
+}
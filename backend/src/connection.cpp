@@ -3,150 +3,901 @@
 
 #include <crow.h>
 
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <random>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
-#include "database/database_manager.hpp"
+#include "auth/auth_middleware.hpp"
+#include "auth/rate_limit_middleware.hpp"
+#include "auth/session_store.hpp"
+#include "auth/session_token.hpp"
 
+#include "database/storage_backend.hpp"
+
+#include "game/game_channel.hpp"
+#include "game/movement_engine.hpp"
+#include "game/spawn_engine.hpp"
+#include "game/zone.hpp"
+
+#include "models/api_response.hpp"
+#include "models/requests.hpp"
 #include "models/user.hpp"
 
-// ApiResponse defines the standard structure for all API responses.
-// Used to maintain consistent communication format with the frontend.
-class ApiResponse {
- public:
-  // Human-readable message describing the operation result
-  std::string message;
-  
-  // Standard HTTP status code indicating the type of response
-  int http_status_code;
-
-  // Converts the ApiResponse object to a JSON format suitable for HTTP responses
-  crow::json::wvalue ToJson() const {
-    crow::json::wvalue response;
-    response["httpStatusCode"] = http_status_code;
-    response["message"] = message;
-    return response;
+#include "utils/admission_control.hpp"
+#include "utils/admission_middleware.hpp"
+#include "utils/cpu_affinity.hpp"
+#include "utils/drain_middleware.hpp"
+#include "utils/env.hpp"
+#include "utils/graceful_shutdown.hpp"
+#include "utils/json_writer.hpp"
+#include "utils/logger.hpp"
+#include "utils/metrics.hpp"
+#include "utils/metrics_middleware.hpp"
+#include "utils/password_hasher.hpp"
+#include "utils/server_config.hpp"
+#include "utils/tick_scheduler.hpp"
+#include "utils/trace.hpp"
+#include "utils/trace_middleware.hpp"
+#include "utils/worker_pool.hpp"
+
+// Completes res with response on the request's own io_service, so the
+// response is always written from the connection's thread. Safe to call
+// from any thread.
+void respond(asio::io_service* io_service, crow::response& res,
+             crow::response response) {
+  auto result = std::make_shared<crow::response>(std::move(response));
+  io_service->post([&res, result] {
+    res = std::move(*result);
+    res.end();
+  });
+}
+
+// Runs job on executor so slow work (MySQL queries, password hashing) never
+// blocks one of Crow's I/O threads. job must finish by calling respond(),
+// either itself or from a follow-up job dispatched to another executor.
+// When the executor queue is full the request fails fast with 503 instead
+// of piling up. A job that throws instead of responding gets a 500, so the
+// client is never left waiting and the drain count always comes back down.
+template <typename Job>
+void dispatch(WorkerPool& executor, asio::io_service* io_service,
+              crow::response& res, Job job) {
+  auto guarded = [io_service, &res, job = std::move(job)]() mutable {
+    try {
+      job();
+    } catch (const std::exception& e) {
+      LOG_ERROR << "Request job failed: " << e.what();
+      respond(io_service, res, responses::kInternalError.ToResponse());
+    } catch (...) {
+      LOG_ERROR << "Request job failed";
+      respond(io_service, res, responses::kInternalError.ToResponse());
+    }
+  };
+  if (!executor.try_submit(std::move(guarded))) {
+    respond(io_service, res, responses::kServerBusy.ToResponse());
+  }
+}
+
+// Fills request from the JSON body of req. If the body is malformed or a
+// field is missing, completes res with the matching 400 response and
+// returns false.
+template <typename Request>
+bool parse_body(const crow::request& req, crow::response& res,
+                Request& request, std::string& decoded) {
+  ParseStatus status;
+  {
+    StageTimer stage("parse");
+    status = parse_request(req.body, request, decoded);
   }
-};
+  if (status == ParseStatus::kOk) return true;
+
+  res = status == ParseStatus::kMissingField
+            ? responses::kMissingFields.ToResponse()
+            : responses::kInvalidFormat.ToResponse();
+  res.end();
+  return false;
+}
 
+// Adds the counters of a WorkerPool to a JSON object
+void write_executor_stats(const WorkerPoolStats& stats,
+                          crow::json::wvalue& json) {
+  json["threads"] = stats.threads;
+  json["queueCapacity"] = stats.queue_capacity;
+  json["queueDepth"] = stats.queue_depth;
+  json["peakQueueDepth"] = stats.peak_queue_depth;
+  json["active"] = stats.active;
+  json["submitted"] = stats.submitted;
+  json["rejected"] = stats.rejected;
+  json["completed"] = stats.completed;
+  json["dropped"] = stats.dropped;
+  json["averageWaitUs"] =
+      stats.completed ? stats.total_wait_us / stats.completed : 0;
+  json["maxWaitUs"] = stats.max_wait_us;
+}
 
+// Exports the queue depth and busy workers of a WorkerPool as gauges
+void register_executor_gauges(const WorkerPool& executor) {
+  MetricsRegistry& metrics = MetricsRegistry::instance();
+  const std::string labels = "pool=\"" + executor.name() + "\"";
+  metrics.gauge("executor_queue_depth", "Tasks waiting for a worker", labels,
+                [&executor] {
+                  return static_cast<double>(executor.stats().queue_depth);
+                });
+  metrics.gauge("executor_active_tasks", "Tasks currently running", labels,
+                [&executor] {
+                  return static_cast<double>(executor.stats().active);
+                });
+}
 
 int main() {
-  // Initialize the Crow application with core components
-  crow::App<> app;
+  // Initialize the Crow application with core components. MetricsMiddleware
+  // comes first so its timer covers the other middlewares too.
+  crow::App<MetricsMiddleware, DrainMiddleware, TraceMiddleware,
+            AdmissionMiddleware, AuthMiddleware, RateLimitMiddleware>
+      app;
   
   // Set logging level to only show warnings and suppress info messages
   app.loglevel(crow::LogLevel::Warning);
+
+  // Write our logs and Crow's through the asynchronous logger so request
+  // threads never block on the terminal
+  Logger::set_level(
+      Logger::parse_level(EnvLoader::getEnvVariable("LOG_LEVEL", "info")));
+  route_crow_logs();
+
+  // Optionally pick up edits to the .env file without a restart
+  std::unique_ptr<EnvWatcher> env_watcher;
+  if (EnvLoader::getEnvVariable("ENV_WATCH", "0") == "1") {
+    env_watcher = std::make_unique<EnvWatcher>(std::chrono::milliseconds(
+        std::stoul(EnvLoader::getEnvVariable("ENV_WATCH_INTERVAL_MS", "1000"))));
+  }
   
-  // Initialize database connection manager
-  DatabaseManager db;
+  // Initialize the storage backend selected in the .env file (MySQL by
+  // default, or in memory for load testing). Backends are thread-safe, so
+  // the multithreaded handlers below share it.
+  std::unique_ptr<StorageBackend> storage = make_storage_backend();
+  StorageBackend& db = *storage;
+
+  // Dedicated threads for blocking database calls. Handlers hand their
+  // queries to this executor and return immediately, so Crow's I/O threads
+  // keep serving other connections while MySQL works.
+  WorkerPool db_executor(
+      "db",
+      std::stoul(EnvLoader::getEnvVariable("DB_EXECUTOR_THREADS", "8")),
+      std::stoul(
+          EnvLoader::getEnvVariable("DB_EXECUTOR_QUEUE_CAPACITY", "1024")));
+
+  // Passwords are hashed with salted PBKDF2 on their own fixed-size pool:
+  // the work is pure CPU, so one thread per core is enough, and it keeps
+  // both the I/O threads and the database executor free while it runs.
+  PasswordHasher hasher(std::stoi(
+      EnvLoader::getEnvVariable("PASSWORD_HASH_ITERATIONS", "310000")));
+  WorkerPool hash_executor(
+      "hash",
+      std::stoul(EnvLoader::getEnvVariable(
+          "PASSWORD_HASH_THREADS",
+          std::to_string(std::thread::hardware_concurrency()))),
+      std::stoul(
+          EnvLoader::getEnvVariable("PASSWORD_HASH_QUEUE_CAPACITY", "256")));
+
+  // Request ids for every request; with TRACE_FILE set, also per-stage
+  // timings of sampled and slow requests, one JSON line per request
+  std::unique_ptr<TraceExporter> trace_exporter;
+  const std::string trace_file = EnvLoader::getEnvVariable("TRACE_FILE", "");
+  if (!trace_file.empty()) {
+    trace_exporter = std::make_unique<TraceExporter>(
+        trace_file,
+        std::stod(EnvLoader::getEnvVariable("TRACE_SAMPLE_RATE", "0.01")),
+        std::chrono::milliseconds(
+            std::stol(EnvLoader::getEnvVariable("TRACE_SLOW_MS", "250"))));
+    app.get_middleware<TraceMiddleware>().exporter = trace_exporter.get();
+    LOG_INFO << "Writing request traces to " << trace_file;
+  }
+
+  // Signs the session tokens issued by /login and checked by AuthMiddleware
+  TokenSigner signer;
+  auto& auth = app.get_middleware<AuthMiddleware>();
+  auth.signer = &signer;
+
+  // Throttle credential guessing and signup floods per client address and
+  // per username before any hashing or database work. Limits are per
+  // minute with a burst allowance; see .env.example.
+  auto& rate_limit = app.get_middleware<RateLimitMiddleware>();
+  rate_limit.configure(
+      std::stoul(EnvLoader::getEnvVariable("RATE_LIMIT_TABLE_SIZE", "65536")),
+      EnvLoader::getEnvVariable("RATE_LIMIT_TRUST_FORWARDED", "0") == "1");
+  rate_limit.limit("/login", RouteLimits::from_env(
+      "LOGIN", RouteLimits{{30.0 / 60, 10}, {10.0 / 60, 5}}));
+  rate_limit.limit("/signup", RouteLimits::from_env(
+      "SIGNUP", RouteLimits{{10.0 / 60, 5}, {0, 0}}));
+
+  // Refuse requests up front with 503 once the database falls behind,
+  // judged by the backlog of its executor and the recent p99 of its tasks.
+  // Health checks and monitoring are always served; signups are shed
+  // first, then logins and game actions once the overload is severe.
+  AdmissionController admission(
+      db_executor,
+      AdmissionThresholds{
+          std::stoul(EnvLoader::getEnvVariable("ADMISSION_DB_QUEUE_DEPTH",
+                                               "256")),
+          std::chrono::milliseconds(std::stol(
+              EnvLoader::getEnvVariable("ADMISSION_DB_P99_MS", "500")))},
+      std::chrono::milliseconds(
+          std::stol(EnvLoader::getEnvVariable("ADMISSION_WINDOW_MS", "2000"))));
+  auto& admission_control = app.get_middleware<AdmissionMiddleware>();
+  admission_control.controller = &admission;
+  for (const char* path : {"/", "/stats", "/metrics"}) {
+    admission_control.priority(path, AdmissionPriority::kCritical);
+  }
+  admission_control.priority("/signup", AdmissionPriority::kLow);
+
+  // Server-side sessions of logged-in players, expired after they go idle.
+  // Every token names its session, so ending the session revokes it.
+  SessionStore sessions(
+      std::stoul(EnvLoader::getEnvVariable("SESSION_STORE_SHARDS", "64")),
+      std::chrono::seconds(std::stol(EnvLoader::getEnvVariable(
+          "SESSION_IDLE_TIMEOUT_SECONDS", "3600"))));
+  auth.sessions = &sessions;
+
+  // Wild Pokémon are spawned here rather than in each browser, so every
+  // player in a zone instance sees the same ones. The engine ticks on its
+  // own thread. A fixed SPAWN_SEED replays the same spawns on every run.
+  const std::vector<ZoneGroup> zone_groups{
+      {meadow_zone(),
+       std::stoul(EnvLoader::getEnvVariable("SPAWN_ZONES", "1000"))}};
+  const std::string spawn_seed = EnvLoader::getEnvVariable("SPAWN_SEED", "");
+  SpawnEngine spawn_engine(
+      zone_groups,
+      spawn_seed.empty() ? std::random_device()() : std::stoull(spawn_seed));
+  TickScheduler spawn_ticks(
+      "spawn",
+      std::chrono::milliseconds(
+          std::stol(EnvLoader::getEnvVariable("SPAWN_TICK_MS", "1000"))),
+      [&spawn_engine] { spawn_engine.tick(); });
+
+  // Players move on the server too, in the same zones. Moves are queued
+  // by the request threads and applied together every MOVE_TICK_MS.
+  MovementEngine movement(
+      zone_groups,
+      std::stoul(EnvLoader::getEnvVariable("MOVE_QUEUE_CAPACITY", "65536")));
+
+  // Real-time clients get what changed in their zone over the /game
+  // WebSocket, in one binary frame per movement tick
+  GameChannel channel(
+      spawn_engine, movement,
+      std::stoul(EnvLoader::getEnvVariable("CHANNEL_SEND_BUFFER_BYTES",
+                                           "65536")),
+      std::stoul(EnvLoader::getEnvVariable("CHANNEL_STALL_TICKS", "100")));
+  TickScheduler movement_ticks(
+      "movement",
+      std::chrono::milliseconds(
+          std::stol(EnvLoader::getEnvVariable("MOVE_TICK_MS", "100"))),
+      [&movement, &channel] {
+        movement.tick();
+        channel.flush();
+      });
+
+  // Latency histograms and response counters per route, plus gauges that
+  // are sampled only when /metrics is scraped
+  auto& request_metrics = app.get_middleware<MetricsMiddleware>();
+  for (const char* path : {"/", "/stats", "/metrics", "/signup", "/login",
+                           "/session", "/logout", "/zones/<uint>/spawns",
+                           "/zones/<uint>/enter", "/zones/<uint>/move",
+                           "/zones/<uint>/players", "/game"}) {
+    request_metrics.add_route(path);
+  }
+  register_executor_gauges(db_executor);
+  register_executor_gauges(hash_executor);
+
+  MetricsRegistry& metrics = MetricsRegistry::instance();
+  metrics.gauge("db_pool_connections", "Open pooled database connections",
+                "state=\"open\"",
+                [&db] { return static_cast<double>(db.pool_stats().open); });
+  metrics.gauge("db_pool_connections", "Open pooled database connections",
+                "state=\"idle\"",
+                [&db] { return static_cast<double>(db.pool_stats().idle); });
+  metrics.gauge("db_pool_waiting", "Threads waiting for a pooled connection",
+                "",
+                [&db] { return static_cast<double>(db.pool_stats().waiting); });
+  metrics.gauge("sessions_live", "Sessions currently held by the store", "",
+                [&sessions] {
+                  return static_cast<double>(sessions.stats().sessions);
+                });
+  metrics.gauge("admission_overload_level",
+                "Database overload: 0 none, 1 elevated, 2 severe", "",
+                [&admission] {
+                  return static_cast<double>(admission.level());
+                });
+  metrics.gauge("spawn_live", "Wild Pokémon currently spawned", "",
+                [&spawn_engine] {
+                  return static_cast<double>(spawn_engine.stats().live);
+                });
+  metrics.gauge("players_in_zones", "Players currently in a zone", "",
+                [&movement] {
+                  return static_cast<double>(movement.stats().players);
+                });
+  metrics.gauge("game_channel_connections", "Open /game WebSockets", "",
+                [&channel] {
+                  return static_cast<double>(channel.stats().connections);
+                });
+  metrics.gauge("log_records_dropped", "Log records lost to a full buffer",
+                "", [] {
+                  return static_cast<double>(Logger::instance().stats().dropped);
+                });
 
   // Health check endpoint to verify API is operational
   CROW_ROUTE(app, "/")([]() {
     return "Registration API is operational";
   });
 
+  // Prometheus text exposition of the metrics registered above
+  CROW_ROUTE(app, "/metrics")([]() {
+    crow::response res(200, MetricsRegistry::instance().render());
+    res.set_header("Content-Type", "text/plain; version=0.0.4");
+    return res;
+  });
+
+  // Reports database pool, duplicate index and executor counters for
+  // capacity planning
+  CROW_ROUTE(app, "/stats")(
+      [&db, &db_executor, &hash_executor, &sessions, &rate_limit,
+       &admission, &spawn_engine, &spawn_ticks, &movement, &movement_ticks,
+       &channel, &trace_exporter]() {
+    crow::json::wvalue json;
+
+    const PoolStats pool = db.pool_stats();
+    json["pool"]["open"] = pool.open;
+    json["pool"]["idle"] = pool.idle;
+    json["pool"]["waiting"] = pool.waiting;
+    json["pool"]["timeouts"] = pool.timeouts;
+    json["pool"]["evictions"] = pool.evictions;
+    json["pool"]["statementCacheHits"] = pool.statement_cache_hits;
+    json["pool"]["statementCacheMisses"] = pool.statement_cache_misses;
+
+    const UserIndexStats index = db.user_index_stats();
+    json["userIndex"]["usernames"] = index.usernames;
+    json["userIndex"]["emails"] = index.emails;
+    json["userIndex"]["rejected"] = index.rejected;
+
+    const SessionStoreStats session_stats = sessions.stats();
+    json["sessions"]["live"] = session_stats.sessions;
+    json["sessions"]["shards"] = session_stats.shards;
+    json["sessions"]["bytes"] = session_stats.bytes;
+    json["sessions"]["fixedBytes"] = session_stats.fixed_bytes;
+    json["sessions"]["bytesPerSession"] = session_stats.bytes_per_session;
+    json["sessions"]["created"] = session_stats.created;
+    json["sessions"]["expired"] = session_stats.expired;
+    json["sessions"]["removed"] = session_stats.removed;
+
+    const RateLimiterStats limits = rate_limit.stats();
+    json["rateLimit"]["capacity"] = limits.capacity;
+    json["rateLimit"]["allowed"] = limits.allowed;
+    json["rateLimit"]["limited"] = limits.limited;
+    json["rateLimit"]["evictions"] = limits.evictions;
+
+    const AdmissionStats shedding = admission.stats();
+    json["admission"]["level"] = static_cast<int>(shedding.level);
+    json["admission"]["dbQueueDepth"] = shedding.queue_depth;
+    json["admission"]["dbP99Us"] = shedding.p99_us;
+    json["admission"]["rejectedNormal"] = shedding.rejected_normal;
+    json["admission"]["rejectedLow"] = shedding.rejected_low;
+
+    const SpawnEngineStats spawns = spawn_engine.stats();
+    const TickSchedulerStats ticks = spawn_ticks.stats();
+    json["spawns"]["zones"] = spawns.zones;
+    json["spawns"]["areas"] = spawns.areas;
+    json["spawns"]["live"] = spawns.live;
+    json["spawns"]["tick"] = spawns.tick;
+    json["spawns"]["spawned"] = spawns.spawned;
+    json["spawns"]["despawned"] = spawns.despawned;
+    json["spawns"]["bytes"] = spawns.bytes;
+    json["spawns"]["bytesPerZone"] =
+        spawns.zones ? spawns.bytes / spawns.zones : 0;
+    json["spawns"]["tickOverruns"] = ticks.overruns;
+    json["spawns"]["ticksSkipped"] = ticks.skipped;
+
+    const MovementStats moves = movement.stats();
+    const TickSchedulerStats move_ticks = movement_ticks.stats();
+    json["movement"]["players"] = moves.players;
+    json["movement"]["tick"] = moves.tick;
+    json["movement"]["steps"] = moves.steps;
+    json["movement"]["blocked"] = moves.blocked;
+    json["movement"]["stale"] = moves.stale;
+    json["movement"]["dropped"] = moves.dropped;
+    json["movement"]["queueCapacity"] = moves.queue_capacity;
+    json["movement"]["tickOverruns"] = move_ticks.overruns;
+    json["movement"]["ticksSkipped"] = move_ticks.skipped;
+
+    const GameChannelStats game = channel.stats();
+    json["channel"]["connections"] = game.connections;
+    json["channel"]["frames"] = game.frames;
+    json["channel"]["bytes"] = game.bytes;
+    json["channel"]["bytesPerFrame"] = game.frames ? game.bytes / game.frames
+                                                   : 0;
+    json["channel"]["messages"] = game.messages;
+    json["channel"]["badMessages"] = game.bad_messages;
+    json["channel"]["deferred"] = game.deferred;
+    json["channel"]["closedSlow"] = game.closed_slow;
+    json["channel"]["dropped"] = game.dropped;
+
+    const LoggerStats log = Logger::instance().stats();
+    json["logger"]["written"] = log.written;
+    json["logger"]["dropped"] = log.dropped;
+    json["logger"]["threads"] = log.threads;
+
+    if (trace_exporter) {
+      const TraceExporterStats traces = trace_exporter->stats();
+      json["traces"]["exported"] = traces.exported;
+      json["traces"]["dropped"] = traces.dropped;
+    }
+
+    write_executor_stats(db_executor.stats(), json["dbExecutor"]);
+    write_executor_stats(hash_executor.stats(), json["hashExecutor"]);
+    return json;
+  });
+
   // User registration endpoint - handles new user creation
-  CROW_ROUTE(app, "/signup").methods(crow::HTTPMethod::POST)(
-    [&db](const crow::request& req) {
+  CROW_ROUTE(app, "/signup").methods(crow::HTTPMethod::POST)
+      .CROW_MIDDLEWARES(app, RateLimitMiddleware)(
+    [&app, &db, &db_executor, &hash_executor, &hasher](
+        const crow::request& req, crow::response& res) {
+      // Stages below, and the jobs dispatched from here, record into this
+      // request's trace
+      ActiveTrace active(app.get_context<TraceMiddleware>(req).trace);
+
+      // Parse and validate the incoming JSON request body
+      SignupRequest request;
+      std::string decoded;
+      if (!parse_body(req, res, request, decoded)) return;
+
+      // Create user object from the validated request data
+      User user{
+          std::string(request.username),
+          std::string(request.email),
+          std::string(request.password)
+      };
+
+      // Validate email format (basic check for @ symbol)
+      bool valid_email;
+      {
+        StageTimer stage("validate");
+        valid_email = user.email.find('@') != std::string::npos;
+      }
+      if (!valid_email) {
+        res = responses::kInvalidEmail.ToResponse();
+        res.end();
+        return;
+      }
+
+      // Known duplicates are refused here, in memory, so a taken name
+      // never costs a slot on the hashing pool
       try {
-        // Parse the incoming JSON request body
-        auto body = crow::json::load(req.body);
-
-        // Verify all required fields are present in the request
-        if (!body.has("username") || !body.has("email") || 
-            !body.has("password")) {
-          ApiResponse response{
-              "Missing required fields in request",
-              400
-          };
-          return crow::response(400, response.ToJson());
-        }
+        StageTimer stage("duplicate");
+        db.check_duplicate(user);
+      } catch (const std::runtime_error& e) {
+        ApiResponse response{e.what(), 409};
+        res = response.ToResponse();
+        res.end();
+        return;
+      }
 
-        // Create user object from the validated request data
-        User user{
-            body["username"].s(),
-            body["email"].s(),
-            body["password"].s()
-        };
-
-        // Validate email format (basic check for @ symbol)
-        if (user.email.find('@') == std::string::npos) {
-          ApiResponse response{
-              "Invalid email format",
-              400
-          };
-          return crow::response(400, response.ToJson());
+      // Hash the password on the hashing pool, then run the INSERT on the
+      // database executor
+      auto* io_service = req.io_service;
+      dispatch(hash_executor, io_service, res,
+               [&db, &db_executor, &hasher, io_service, &res,
+                user = std::move(user)]() mutable {
+        try {
+          StageTimer stage("hash");
+          user.password = hasher.hash(user.password);
+        } catch (const std::runtime_error& e) {
+          respond(io_service, res, responses::kInternalError.ToResponse());
+          return;
         }
 
-        try {
-          // Attempt to create the user in the database
-          if (db.create_user(user)) {
-            ApiResponse response{
-                "User successfully registered",
-                201
-            };
-            return crow::response(201, response.ToJson());
+        dispatch(db_executor, io_service, res,
+                 [&db, io_service, &res, user = std::move(user)] {
+          try {
+            // Attempt to create the user in the database
+            if (db.create_user(user)) {
+              respond(io_service, res, responses::kUserRegistered.ToResponse());
+              return;
+            }
+          } catch (const PoolTimeoutError& e) {
+            // Every pooled connection is busy; ask the client to retry
+            ApiResponse response{e.what(), 503};
+            respond(io_service, res, response.ToResponse());
+            return;
+          } catch (const std::runtime_error& e) {
+            // Handle specific database errors (like duplicate users)
+            ApiResponse response{e.what(), 409};
+            respond(io_service, res, response.ToResponse());
+            return;
           }
+
+          // Handle unexpected server errors
+          respond(io_service, res, responses::kInternalError.ToResponse());
+        });
+      });
+    }
+  );
+
+  
+  CROW_ROUTE(app, "/login").methods(crow::HTTPMethod::POST)
+      .CROW_MIDDLEWARES(app, RateLimitMiddleware)(
+    [&app, &db, &db_executor, &hash_executor, &hasher, &signer, &sessions](
+        const crow::request& req, crow::response& res) {
+      ActiveTrace active(app.get_context<TraceMiddleware>(req).trace);
+
+      LoginRequest request;
+      std::string decoded;
+      if (!parse_body(req, res, request, decoded)) return;
+
+      // The login form only sends username and password
+      User user {
+        std::string(request.username),
+        "",
+        std::string(request.password)
+      };
+
+      // Fetch the stored hash on the database executor, then check the
+      // password on the hashing pool
+      auto* io_service = req.io_service;
+      dispatch(db_executor, io_service, res,
+               [&db, &hash_executor, &hasher, &signer, &sessions, io_service,
+                &res, user = std::move(user)]() mutable {
+        std::optional<StoredCredentials> stored;
+        try {
+          stored = db.find_credentials(user.username);
+        } catch (const PoolTimeoutError& e) {
+          // Every pooled connection is busy; ask the client to retry
+          ApiResponse response{e.what(), 503};
+          respond(io_service, res, response.ToResponse());
+          return;
         } catch (const std::runtime_error& e) {
-          // Handle specific database errors (like duplicate users)
+          // Handle specific database errors
           ApiResponse response{e.what(), 409};
-          return crow::response(409, response.ToJson());
+          respond(io_service, res, response.ToResponse());
+          return;
+        }
+
+        dispatch(hash_executor, io_service, res,
+                 [&hasher, &signer, &sessions, io_service, &res,
+                  password = std::move(user.password),
+                  stored = std::move(stored)] {
+          // Later requests prove the login with this token instead of
+          // going back to the database
+          std::optional<IssuedToken> session;
+          std::string session_id;
+          try {
+            // Unknown usernames cost as much as a wrong password
+            bool valid;
+            {
+              StageTimer stage("verify");
+              valid = stored ? hasher.verify(password, stored->password_hash)
+                             : hasher.reject(password);
+            }
+            if (valid) {
+              // Keyed by the stored name, so "ASH" and "ash" logging in to
+              // one account are one player
+              StageTimer stage("session");
+              session_id = sessions.create(stored->username);
+              session = signer.issue(stored->username, session_id);
+            }
+          } catch (const std::runtime_error& e) {
+            respond(io_service, res, responses::kInternalError.ToResponse());
+            return;
+          }
+
+          if (session) {
+            static const ApiResponse kLoggedIn{"User successfully login", 201};
+            crow::response reply;
+            {
+              StageTimer stage("serialize");
+              JsonWriter json = JsonWriter::local();
+              json.begin_object();
+              kLoggedIn.WriteFields(json);
+              json.key("token").value(session->token);
+              json.key("expiresAt").value(session->expires_at);
+              json.key("sessionId").value(session_id);
+              json.end_object();
+              reply = json_response(201, json.view());
+            }
+            respond(io_service, res, std::move(reply));
+            return;
+          }
+
+          // Unknown username or wrong password
+          respond(io_service, res, responses::kInvalidCredentials.ToResponse());
+        });
+      });
+    }
+  );
+
+  // Returns the user behind a session token; the token and its session are
+  // checked by AuthMiddleware without touching the database. An
+  // X-Session-Id header names another of the caller's own sessions to
+  // keep alive and report on instead of the token's.
+  CROW_ROUTE(app, "/session").CROW_MIDDLEWARES(app, AuthMiddleware)(
+    [&app, &sessions](const crow::request& req) {
+      const SessionClaims& session = app.get_context<AuthMiddleware>(req).claims;
+      static const ApiResponse kSessionValid{"Session is valid", 200};
+      JsonWriter json = JsonWriter::local();
+      json.begin_object();
+      kSessionValid.WriteFields(json);
+      json.key("username").value(session.username);
+      json.key("expiresAt").value(session.expires_at);
+
+      const std::string& header = req.get_header_value("X-Session-Id");
+      const std::string& session_id =
+          header.empty() ? session.session_id : header;
+      if (sessions.touch(session_id, session.username)) {
+        if (auto player = sessions.find(session_id)) {
+          json.key("sessionExpiresAt").value(player->expires_at);
         }
-      } catch (const std::exception& e) {
-        // Handle malformed JSON or general parsing errors
-        ApiResponse response{
-            "Invalid request format",
-            400
-        };
-        return crow::response(400, response.ToJson());
+      }
+      json.end_object();
+      return json_response(200, json.view());
+    }
+  );
+
+  // The wild Pokémon currently in a zone instance, e.g.
+  //   {"zone":3,"name":"meadow","width":26,"height":26,"tick":812,
+  //    "changedAt":790,"spawns":[{"id":25,"level":4,"x":4,"y":10}]}
+  CROW_ROUTE(app, "/zones/<uint>/spawns").CROW_MIDDLEWARES(app, AuthMiddleware)(
+    [&spawn_engine](std::uint64_t zone) {
+      if (zone >= spawn_engine.zone_count()) {
+        return responses::kZoneNotFound.ToResponse();
       }
 
-      // Handle unexpected server errors
-      ApiResponse response{
-          "Internal server error",
-          500
-      };
-      return crow::response(500, response.ToJson());
+      thread_local std::vector<Spawn> spawns;
+      const std::uint64_t changed = spawn_engine.spawns(zone, spawns);
+      const ZoneTemplate& rules = spawn_engine.zone_template(zone);
+
+      JsonWriter json = JsonWriter::local();
+      json.begin_object();
+      json.key("zone").value(zone);
+      json.key("name").value(rules.name);
+      json.key("width").value(rules.width);
+      json.key("height").value(rules.height);
+      json.key("tick").value(spawn_engine.now());
+      json.key("changedAt").value(changed);
+      json.key("spawns").begin_array();
+      for (const Spawn& spawn : spawns) {
+        json.begin_object();
+        json.key("id").value(spawn.species);
+        json.key("level").value(spawn.level);
+        json.key("x").value(spawn.x);
+        json.key("y").value(spawn.y);
+        json.end_object();
+      }
+      json.end_array();
+      json.end_object();
+      return json_response(200, json.view());
     }
   );
 
-  
-  CROW_ROUTE(app, "/login").methods(crow::HTTPMethod::POST)(
-    [&db](const crow::request& req) {
-      auto body = crow::json::load(req.body);
-
-      // Verify all required fields are present in the request
-      if (!body.has("username") || !body.has("password")) {
-        ApiResponse response {
-            "Missing required fields in request",
-            400
-        };
-        return crow::response(400, response.ToJson());
+  // Puts the caller's player in a zone instance, e.g. {"zone":3,"player":7}.
+  // The player appears at the zone's entry on the next movement tick.
+  CROW_ROUTE(app, "/zones/<uint>/enter").methods(crow::HTTPMethod::POST)
+      .CROW_MIDDLEWARES(app, AuthMiddleware)(
+    [&app, &movement, &sessions](const crow::request& req,
+                                 std::uint64_t zone) {
+      if (zone >= movement.zone_count()) {
+        return responses::kZoneNotFound.ToResponse();
       }
+      const SessionClaims& session = app.get_context<AuthMiddleware>(req).claims;
+      const ZoneEntry entry = movement.enter(session.username, zone);
+      sessions.set_zone_ticket(session.session_id, entry.ticket);
 
-      User user {
-        body["username"].s(),
-        body["email"].s(),
-        body["password"].s()
-      };
-      
-      try {
-        if (db.login_user(user)) {
-          ApiResponse response{
-                "User successfully login",
-                201
-            };
-            return crow::response(201, response.ToJson());
+      JsonWriter json = JsonWriter::local();
+      json.begin_object();
+      json.key("zone").value(zone);
+      json.key("player").value(entry.player);
+      json.end_object();
+      return json_response(200, json.view());
+    }
+  );
+
+  // Queues one step, e.g. {"direction":"up"}. Answers 202 at once; the
+  // step is applied on the next movement tick and shows in /players.
+  CROW_ROUTE(app, "/zones/<uint>/move").methods(crow::HTTPMethod::POST)
+      .CROW_MIDDLEWARES(app, AuthMiddleware)(
+    [&app, &movement](const crow::request& req, crow::response& res,
+                      std::uint64_t zone) {
+      if (zone >= movement.zone_count()) {
+        res = responses::kZoneNotFound.ToResponse();
+        res.end();
+        return;
+      }
+
+      MoveRequest request;
+      std::string decoded;
+      if (!parse_body(req, res, request, decoded)) return;
+
+      const std::optional<Direction> direction =
+          parse_direction(request.direction);
+      const SessionClaims& session = app.get_context<AuthMiddleware>(req).claims;
+      if (!direction) {
+        res = responses::kInvalidDirection.ToResponse();
+      } else {
+        switch (movement.submit(session.username, zone, *direction)) {
+          case MoveStatus::kQueued:
+            res = responses::kMoveQueued.ToResponse();
+            break;
+          case MoveStatus::kNotInZone:
+            res = responses::kNotInZone.ToResponse();
+            break;
+          case MoveStatus::kBusy:
+            res = responses::kServerBusy.ToResponse();
+            break;
         }
-      } catch (const std::runtime_error& e) {
-        // Handle specific database errors (like duplicate users)
-        ApiResponse response{e.what(), 409};
-        return crow::response(409, response.ToJson());
       }
+      res.end();
+    }
+  );
+
+  // The players in a zone instance as of the last movement tick, e.g.
+  //   {"zone":3,"tick":5120,"changedAt":5118,
+  //    "players":[{"id":7,"x":9,"y":2}]}
+  CROW_ROUTE(app, "/zones/<uint>/players").CROW_MIDDLEWARES(app, AuthMiddleware)(
+    [&movement](std::uint64_t zone) {
+      if (zone >= movement.zone_count()) {
+        return responses::kZoneNotFound.ToResponse();
+      }
+
+      thread_local std::vector<PlayerPosition> players;
+      const std::uint64_t changed = movement.players(zone, players);
+
+      JsonWriter json = JsonWriter::local();
+      json.begin_object();
+      json.key("zone").value(zone);
+      json.key("tick").value(movement.stats().tick);
+      json.key("changedAt").value(changed);
+      json.key("players").begin_array();
+      for (const PlayerPosition& player : players) {
+        json.begin_object();
+        json.key("id").value(player.player);
+        json.key("x").value(player.x);
+        json.key("y").value(player.y);
+        json.end_object();
+      }
+      json.end_array();
+      json.end_object();
+      return json_response(200, json.view());
     }
   );
 
-  // Start the server on port 3000 with multi-threading enabled
-  app.port(3000).multithreaded().run();
+  // Real-time play; the binary protocol is described in game_channel.hpp.
+  // Browsers cannot set headers on a WebSocket, so the session token comes
+  // in the query string: /game?token=<token>
+  CROW_WEBSOCKET_ROUTE(app, "/game")
+      .onaccept([&app, &request_metrics, &signer, &sessions, &channel](
+                    const crow::request& req, void** session) {
+        auto& timing = app.get_context<MetricsMiddleware>(req);
+        const char* token = req.url_params.get("token");
+        auto claims = token ? signer.verify(token) : std::nullopt;
+        if (!claims || !sessions.touch(claims->session_id, claims->username)) {
+          request_metrics.record_upgrade(req, timing, 401);
+          return false;
+        }
+        *session = channel.accept(std::move(claims->username),
+                                  std::move(claims->session_id));
+        request_metrics.record_upgrade(req, timing, 101);
+        return true;
+      })
+      .onopen([&channel](crow::websocket::connection& connection) {
+        channel.open(connection);
+      })
+      .onmessage([&channel](crow::websocket::connection& connection,
+                            const std::string& data, bool is_binary) {
+        channel.message(connection, data, is_binary);
+      })
+      .onclose([&channel](crow::websocket::connection& connection,
+                          const std::string&) { channel.close(connection); });
+
+  // Ends a server-side session created by /login. Its token stops working
+  // at once and its /game connections are closed.
+  CROW_ROUTE(app, "/logout").methods(crow::HTTPMethod::POST)
+      .CROW_MIDDLEWARES(app, AuthMiddleware)(
+    [&app, &sessions, &movement, &channel](const crow::request& req) {
+      const SessionClaims& session = app.get_context<AuthMiddleware>(req).claims;
+
+      // A malformed body is treated like a missing field
+      LogoutRequest request;
+      std::string decoded;
+      if (parse_request(req.body, request, decoded) != ParseStatus::kOk ||
+          request.session_id.empty()) {
+        return responses::kMissingFields.ToResponse();
+      }
+
+      // Only the session's owner may end it
+      const std::string session_id(request.session_id);
+      const std::optional<Session> ended =
+          sessions.remove(session_id, session.username);
+      if (!ended) return responses::kSessionNotFound.ToResponse();
+
+      // The session's sockets leave the zone as they close. Its HTTP entry
+      // is undone only if no other session has entered the player since.
+      channel.end_session(session_id);
+      if (ended->zone_ticket != 0) {
+        movement.leave(session.username, ended->zone_ticket);
+      }
+      return responses::kSessionEnded.ToResponse();
+    }
+  );
+
+  // Port, thread count, CPU placement and listener options of the server
+  const ServerConfig server;
+  app.port(server.port).concurrency(server.threads)
+      .reuse_port(server.reuse_port);
+
+  // Crow starts its threads from this one, so restricting it here keeps the
+  // acceptor and every I/O thread on the configured cores. The executors
+  // above were started earlier and may still use any core.
+  if (!server.cpus.empty() && !set_thread_affinity(server.cpus)) {
+    LOG_WARNING << "Could not restrict the server threads to SERVER_CPUS";
+  }
+
+  // Optionally give each I/O thread a core of its own, taken in turn from
+  // SERVER_CPUS or, when that is empty, from all cores
+  if (server.pin_threads) {
+    std::vector<int> cores = server.cpus;
+    if (cores.empty()) {
+      for (unsigned cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu) {
+        cores.push_back(static_cast<int>(cpu));
+      }
+    }
+    app.on_io_thread_start([cores](std::uint16_t index) {
+      const int cpu = cores[index % cores.size()];
+      if (!set_thread_affinity({cpu})) {
+        LOG_WARNING << "Could not pin I/O thread " << index << " to CPU "
+                    << cpu;
+      }
+    });
+  }
+
+  LOG_INFO << "Listening on port " << server.port << " with "
+           << app.concurrency() << " threads"
+           << (server.pin_threads ? ", pinned to cores" : "")
+           << (server.reuse_port ? ", SO_REUSEPORT" : "");
+
+  // On SIGINT or SIGTERM, stop accepting and let in-flight requests finish
+  // before stopping, within DRAIN_TIMEOUT_MS. Crow would otherwise stop at
+  // once and cut signups off in the middle of their database work.
+  app.signal_clear();
+  GracefulShutdown graceful_shutdown(
+      app.get_middleware<DrainMiddleware>(),
+      server.drain_timeout,
+      [&app] {
+        app.wait_for_server_start();
+        app.stop_accepting();
+      },
+      [&app] { app.stop(); });
+  app.run();
+
+  // Signup and login jobs hand work between the two executors. Drain the
+  // hashing pool first, so a signup that was hashing still gets its
+  // INSERT run. A login whose lookup ends after that answers 503 and can
+  // simply be retried. Work still queued at the drain deadline is
+  // dropped; running queries always complete.
+  const auto deadline = graceful_shutdown.deadline();
+  hash_executor.shutdown(deadline);
+  db_executor.shutdown(deadline);
+
+  // Keep the final counters, which the last scrape may have missed
+  const std::string metrics_file =
+      EnvLoader::getEnvVariable("METRICS_SHUTDOWN_FILE", "");
+  if (!metrics_file.empty()) {
+    std::ofstream(metrics_file) << MetricsRegistry::instance().render();
+  }
+  trace_exporter.reset();
+  LOG_INFO << "Shut down";
+  Logger::instance().flush();
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,173 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the MySQL connection pool used by DatabaseManager
+
+#include "database/connection_pool.hpp"
+#include <cppconn/driver.h>
+#include <cppconn/exception.h>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "utils/metrics.hpp"
+#include "utils/trace.hpp"
+
+PooledConnection::PooledConnection(std::unique_ptr<sql::Connection> conn,
+                                   std::atomic<std::size_t>* hits,
+                                   std::atomic<std::size_t>* misses)
+    : conn(std::move(conn)), hits(hits), misses(misses) {}
+
+sql::PreparedStatement& PooledConnection::prepare(const std::string& query) {
+  auto it = statements.find(query);
+  if (it != statements.end()) {
+    hits->fetch_add(1, std::memory_order_relaxed);
+    return *it->second;
+  }
+  misses->fetch_add(1, std::memory_order_relaxed);
+  StageTimer stage("db.prepare");
+  std::unique_ptr<sql::PreparedStatement> stmt(conn->prepareStatement(query));
+  return *statements.emplace(query, std::move(stmt)).first->second;
+}
+
+ConnectionPool::Lease::Lease(ConnectionPool* pool,
+                             std::unique_ptr<PooledConnection> conn)
+    : pool(pool), conn(std::move(conn)) {}
+
+ConnectionPool::Lease::Lease(Lease&& other) noexcept
+    : pool(other.pool), conn(std::move(other.conn)), broken(other.broken) {}
+
+ConnectionPool::Lease::~Lease() {
+  if (conn) {
+    pool->release(std::move(conn), broken);
+  }
+}
+
+ConnectionPool::ConnectionPool(const DBConfig& config)
+    : config(config),
+      min_size(std::max<std::size_t>(config.pool_min_size, 1)),
+      max_size(std::max(config.pool_max_size,
+                        std::max<std::size_t>(config.pool_min_size, 1))),
+      idle_timeout(config.pool_idle_timeout_ms),
+      wait_timeout(config.pool_wait_timeout_ms) {}
+
+void ConnectionPool::warm_up() {
+  std::lock_guard<std::mutex> lock(mutex);
+  while (open < min_size) {
+    idle.push_back({open_connection(), Clock::now()});
+    ++open;
+  }
+}
+
+std::unique_ptr<PooledConnection> ConnectionPool::open_connection() {
+  sql::Driver* driver = get_driver_instance();
+  sql::ConnectOptionsMap options;
+  options["hostName"] = config.host;
+  options["userName"] = config.user;
+  options["password"] = config.password;
+  options["schema"] = config.database;
+  // Pooled connections can sit idle past the server's wait_timeout; let the
+  // connector re-establish them transparently on next use.
+  options[OPT_RECONNECT] = true;
+  return std::make_unique<PooledConnection>(
+      std::unique_ptr<sql::Connection>(driver->connect(options)),
+      &statement_cache_hits, &statement_cache_misses);
+}
+
+ConnectionPool::Lease ConnectionPool::acquire() {
+  // Time to hand out a connection, including opening one and waits that
+  // end in a timeout
+  static const Histogram checkout_wait = MetricsRegistry::instance().histogram(
+      "db_pool_checkout_seconds", "Time spent acquiring a pooled connection");
+  ScopedTimer timer(checkout_wait);
+  StageTimer stage("db.checkout");
+
+  std::vector<std::unique_ptr<PooledConnection>> evicted;
+  std::unique_lock<std::mutex> lock(mutex);
+  const auto deadline = Clock::now() + wait_timeout;
+
+  while (true) {
+    auto expired = evict_idle_locked(Clock::now());
+    std::move(expired.begin(), expired.end(), std::back_inserter(evicted));
+
+    if (!idle.empty()) {
+      auto conn = std::move(idle.back().conn);
+      idle.pop_back();
+      lock.unlock();
+      return Lease(this, std::move(conn));
+    }
+
+    if (open < max_size) {
+      // Reserve the slot before connecting so concurrent callers cannot
+      // overshoot max_size while the handshake runs without the lock.
+      ++open;
+      lock.unlock();
+      try {
+        return Lease(this, open_connection());
+      } catch (...) {
+        lock.lock();
+        --open;
+        available.notify_one();
+        throw;
+      }
+    }
+
+    ++waiting;
+    const bool signalled = available.wait_until(lock, deadline, [this] {
+      return !idle.empty() || open < max_size;
+    });
+    --waiting;
+    if (!signalled) {
+      ++timeouts;
+      throw PoolTimeoutError("Timed out waiting for a database connection");
+    }
+  }
+}
+
+void ConnectionPool::release(std::unique_ptr<PooledConnection> conn,
+                             bool broken) {
+  std::vector<std::unique_ptr<PooledConnection>> evicted;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (broken || (*conn)->isClosed()) {
+      --open;
+      evicted.push_back(std::move(conn));
+    } else {
+      const auto now = Clock::now();
+      idle.push_back({std::move(conn), now});
+      auto expired = evict_idle_locked(now);
+      std::move(expired.begin(), expired.end(), std::back_inserter(evicted));
+    }
+  }
+  available.notify_one();
+  // Closing a connection talks to the server, so do it outside the lock.
+  for (auto& stale : evicted) {
+    try {
+      stale.reset();
+    } catch (sql::SQLException&) {
+      // The connection is being discarded anyway.
+    }
+  }
+}
+
+std::vector<std::unique_ptr<PooledConnection>>
+ConnectionPool::evict_idle_locked(Clock::time_point now) {
+  std::vector<std::unique_ptr<PooledConnection>> expired;
+  // idle is ordered oldest first, so stop at the first connection that is
+  // still fresh or once only the minimum would remain.
+  auto it = idle.begin();
+  while (it != idle.end() && open - expired.size() > min_size &&
+         now - it->idle_since > idle_timeout) {
+    expired.push_back(std::move(it->conn));
+    ++it;
+  }
+  idle.erase(idle.begin(), it);
+  open -= expired.size();
+  evictions += expired.size();
+  return expired;
+}
+
+PoolStats ConnectionPool::stats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return {open, idle.size(), waiting, timeouts, evictions,
+          statement_cache_hits.load(std::memory_order_relaxed),
+          statement_cache_misses.load(std::memory_order_relaxed)};
+}
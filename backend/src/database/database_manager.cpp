@@ -2,130 +2,177 @@
 // Implementation of DatabaseManager class that handles all database operations
 
 #include "database/database_manager.hpp"
+#include "database/schema_migrations.hpp"
+#include "database/signup_batcher.hpp"
 #include <cppconn/driver.h>
 #include <cppconn/exception.h>
 #include <cppconn/prepared_statement.h>
-#include <iostream>
 #include <memory>
 #include <string>
 
-DatabaseManager::DatabaseManager() {
+#include "utils/logger.hpp"
+#include "utils/metrics.hpp"
+#include "utils/trace.hpp"
+
+namespace {
+
+Histogram operation_latency(const char* operation) {
+  return MetricsRegistry::instance().histogram(
+      "db_operation_duration_seconds", "Time spent in DatabaseManager calls",
+      std::string("operation=\"") + operation + "\"");
+}
+
+}  // namespace
+
+DatabaseManager::DatabaseManager()
+    : pool(config),
+      user_index(config.user_index ? std::make_unique<UserIndex>() : nullptr) {
   try {
-    // Establish initial database connection
-    std::cout << "Attempting to connect to database..." << std::endl;
-    sql::Driver* driver = get_driver_instance();
-    conn.reset(driver->connect(config.host, config.user, config.password));
-    conn->setSchema(config.database);
+    // Open the pool's initial connections and borrow one for the schema
+    // migrations
+    LOG_INFO << "Attempting to connect to database...";
+    pool.warm_up();
+    auto conn = pool.acquire();
     
-    // Check if the users table already exists in the database
-    std::unique_ptr<sql::Statement> stmt(conn->createStatement());
-    std::unique_ptr<sql::ResultSet> tables(stmt->executeQuery(
-        "SELECT COUNT(*) FROM information_schema.tables "
-        "WHERE table_schema = '" + std::string(config.database) + "' "
-        "AND table_name = 'users'"
-    ));
-    
-    tables->next();
-    bool table_exists = tables->getInt(1) > 0;
-    
-    if (!table_exists) {
-      // Create the users table if it doesn't exist
-      std::cout << "Creating 'users' table..." << std::endl;
-      stmt->execute(
-          "CREATE TABLE users ("
-          "IdUser INT AUTO_INCREMENT PRIMARY KEY,"
-          "email VARCHAR(255) UNIQUE NOT NULL,"
-          "username VARCHAR(255) UNIQUE NOT NULL,"
-          "password VARCHAR(255) NOT NULL"
-          ")"
-      );
-      std::cout << "Successfully created 'users' table" << std::endl;
-    } else {
-      std::cout << "Successfully connected to existing 'users' table" 
-                << std::endl;
+    // Bring the schema up to date; a single version check when it already is
+    migrate_schema(*conn);
+
+    if (user_index) {
+      // Load every taken username and email so duplicate signups can be
+      // rejected without a round trip
+      std::unique_ptr<sql::Statement> stmt(conn->createStatement());
+      std::unique_ptr<sql::ResultSet> users(
+          stmt->executeQuery("SELECT username, email FROM users"));
+      while (users->next()) {
+        user_index->add(users->getString(1), users->getString(2));
+      }
+      LOG_INFO << "Indexed " << user_index->stats().usernames
+               << " existing users";
     }
   } catch (sql::SQLException& e) {
     // Log detailed SQL error information before re-throwing
-    std::cerr << "SQL Error in constructor: " << e.what() << std::endl;
-    std::cerr << "MySQL Error Code: " << e.getErrorCode() << std::endl;
-    std::cerr << "SQL State: " << e.getSQLState() << std::endl;
+    LOG_ERROR << "SQL Error in constructor: " << e.what();
+    LOG_ERROR << "MySQL Error Code: " << e.getErrorCode();
+    LOG_ERROR << "SQL State: " << e.getSQLState();
     throw;  // Re-throw the exception for higher-level handling
   }
+
+  if (config.signup_batching) {
+    signup_batcher = std::make_unique<SignupBatcher>(pool, config);
+  }
+}
+
+DatabaseManager::~DatabaseManager() = default;
+
+std::runtime_error user_insert_error(const sql::SQLException& e) {
+  // Handle duplicate entry errors (MySQL error code 1062)
+  if (e.getErrorCode() == 1062) {
+    // Check which unique constraint was violated
+    if (std::string(e.what()).find("username") != std::string::npos) {
+      return std::runtime_error("Username is already taken");
+    }
+    if (std::string(e.what()).find("email") != std::string::npos) {
+      return std::runtime_error("Email is already registered");
+    }
+    return std::runtime_error("User or email already exists in the system");
+  }
+
+  // Handle other database errors
+  return std::runtime_error("Error connecting to database");
+}
+
+void DatabaseManager::check_duplicate(const User& user) {
+  // Answer obvious duplicates from memory with the same messages MySQL's
+  // unique constraints would produce
+  if (!user_index) return;
+  if (user_index->has_username(user.username)) {
+    user_index->record_rejection();
+    throw std::runtime_error("Username is already taken");
+  }
+  if (user_index->has_email(user.email)) {
+    user_index->record_rejection();
+    throw std::runtime_error("Email is already registered");
+  }
 }
 
 bool DatabaseManager::create_user(const User& user) {
+  static const Histogram latency = operation_latency("create_user");
+  ScopedTimer timer(latency);
+
+  check_duplicate(user);
+
+  if (signup_batcher) {
+    LOG_INFO << "Queueing user for batched insert: " << user.username;
+    // Rethrows this row's outcome (duplicate, database error, pool timeout)
+    {
+      StageTimer stage("db.batch");
+      signup_batcher->submit(user).get();
+    }
+    if (user_index) user_index->add(user.username, user.email);
+    LOG_INFO << "User created successfully";
+    return true;
+  }
+
   try {
-    std::cout << "Attempting to create user: " << user.username << std::endl;
-    
-    // Prepare the SQL statement with parameterized query for security
-    const std::string query =
-        "INSERT INTO users (email, username, password) "
-        "VALUES (?, ?, ?)";
-    
-    std::unique_ptr<sql::PreparedStatement> prep_stmt(
-        conn->prepareStatement(query)
-    );
+    LOG_INFO << "Attempting to create user: " << user.username;
     
-    // Bind parameters to the prepared statement
-    prep_stmt->setString(1, user.email);
-    prep_stmt->setString(2, user.username);
-    prep_stmt->setString(3, user.password);
-    
-    // Execute the prepared statement
-    prep_stmt->execute();
-    std::cout << "User created successfully" << std::endl;
+    // The parameterized statement is prepared once per pooled connection
+    // and reused
+    auto conn = pool.acquire();
+    conn.execute(kInsertUserQuery, [&user](sql::PreparedStatement& prep_stmt) {
+      // Bind parameters to the prepared statement
+      prep_stmt.setString(1, user.email);
+      prep_stmt.setString(2, user.username);
+      prep_stmt.setString(3, user.password);
+
+      // Execute the prepared statement
+      prep_stmt.execute();
+    });
+    if (user_index) user_index->add(user.username, user.email);
+    LOG_INFO << "User created successfully";
     return true;
     
   } catch (sql::SQLException& e) {
-    std::cerr << "Error creating user: " << e.what() << std::endl;
-    
-    // Handle duplicate entry errors (MySQL error code 1062)
-    if (e.getErrorCode() == 1062) {
-      // Check which unique constraint was violated
-      if (std::string(e.what()).find("username") != std::string::npos) {
-        throw std::runtime_error("Username is already taken");
-      }
-      if (std::string(e.what()).find("email") != std::string::npos) {
-        throw std::runtime_error("Email is already registered");
-      }
-      throw std::runtime_error("User or email already exists in the system");
-    }
-    
-    // Handle other database errors
-    throw std::runtime_error("Error connecting to database");
+    LOG_ERROR << "Error creating user: " << e.what();
+    throw user_insert_error(e);
   }
 }
 
-bool DatabaseManager::login_user(const User& user) {
+std::optional<StoredCredentials> DatabaseManager::find_credentials(
+    const std::string& username) {
+    static const Histogram latency = operation_latency("find_credentials");
+    ScopedTimer timer(latency);
+
     try {
-        std::cout << "Attempting to login user: " << user.username << std::endl;
+        LOG_INFO << "Attempting to login user: " << username;
 
         const std::string query =
-            "SELECT EXISTS ("
-            "   SELECT 1"
+            "SELECT username, password"
             "   FROM users"
-            "   WHERE username = ? AND password = ?"
-            ") AS is_valid";
-
-        std::unique_ptr<sql::PreparedStatement> prep_stmt(conn->prepareStatement(query));
+            "   WHERE username = ?";
 
-        // Corrected parameter indices (1-based index)
-        prep_stmt->setString(1, user.username);
-        prep_stmt->setString(2, user.password);
+        auto conn = pool.acquire();
+        return conn.execute(query, [&username](sql::PreparedStatement& prep_stmt)
+                                       -> std::optional<StoredCredentials> {
+            prep_stmt.setString(1, username);
 
-        std::unique_ptr<sql::ResultSet> res(prep_stmt->executeQuery());
+            std::unique_ptr<sql::ResultSet> res(prep_stmt.executeQuery());
 
-        if (res->next()) {
-            bool is_valid = res->getBoolean("is_valid");
-            return is_valid;
-        }
+            if (res->next()) {
+                // The stored spelling, which the lookup matched
+                // case-insensitively
+                return StoredCredentials{
+                    std::string(res->getString("username")),
+                    std::string(res->getString("password"))};
+            }
 
-        return false;  // User not found or incorrect credentials
+            return std::nullopt;  // User not found
+        });
 
     } catch (sql::SQLException& e) {
-        std::cerr << "Error code: " << e.getErrorCode() << std::endl;
-        std::cerr << "SQL state: " << e.getSQLState() << std::endl;
-        std::cerr << "Error message: " << e.what() << std::endl;
+        LOG_ERROR << "Error code: " << e.getErrorCode();
+        LOG_ERROR << "SQL state: " << e.getSQLState();
+        LOG_ERROR << "Error message: " << e.what();
         throw std::runtime_error("Database error, try again.");
     }
 }
@@ -0,0 +1,64 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the in-memory storage backend
+
+#include "database/in_memory_storage.hpp"
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+
+#include "utils/fold_case.hpp"
+
+std::size_t InMemoryStorage::shard_of(const std::string& key) {
+  return std::hash<std::string>{}(key) % kShardCount;
+}
+
+bool InMemoryStorage::create_user(const User& user) {
+  const std::string username = fold_case(user.username);
+  const std::string email = fold_case(user.email);
+  UserShard& user_shard = users[shard_of(username)];
+  EmailShard& email_shard = emails[shard_of(email)];
+
+  // The two mutexes always belong to different arrays, and scoped_lock
+  // acquires them without risking a lock-order deadlock
+  std::scoped_lock lock(user_shard.mutex, email_shard.mutex);
+
+  if (user_shard.passwords.count(username)) {
+    throw std::runtime_error("Username is already taken");
+  }
+  if (email_shard.emails.count(email)) {
+    throw std::runtime_error("Email is already registered");
+  }
+
+  user_shard.passwords.emplace(
+      username, StoredCredentials{user.username, user.password});
+  email_shard.emails.insert(email);
+  return true;
+}
+
+void InMemoryStorage::check_duplicate(const User& user) {
+  {
+    const std::string username = fold_case(user.username);
+    const UserShard& shard = users[shard_of(username)];
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    if (shard.passwords.count(username)) {
+      throw std::runtime_error("Username is already taken");
+    }
+  }
+  const std::string email = fold_case(user.email);
+  EmailShard& shard = emails[shard_of(email)];
+  std::shared_lock<std::shared_mutex> lock(shard.mutex);
+  if (shard.emails.count(email)) {
+    throw std::runtime_error("Email is already registered");
+  }
+}
+
+std::optional<StoredCredentials> InMemoryStorage::find_credentials(
+    const std::string& username) {
+  const std::string key = fold_case(username);
+  const UserShard& shard = users[shard_of(key)];
+  std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+  auto it = shard.passwords.find(key);
+  if (it == shard.passwords.end()) return std::nullopt;
+  return it->second;
+}
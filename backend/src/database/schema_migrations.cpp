@@ -0,0 +1,114 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the schema migration runner
+
+#include "database/schema_migrations.hpp"
+#include <cppconn/exception.h>
+#include <cppconn/prepared_statement.h>
+#include <cppconn/resultset.h>
+#include <cppconn/statement.h>
+#include <memory>
+
+#include "utils/logger.hpp"
+
+namespace {
+
+// MySQL error raised when the schema_version table does not exist yet
+constexpr int kNoSuchTable = 1146;
+
+// Seconds to wait for another server that is migrating the same schema
+constexpr int kLockTimeoutSeconds = 30;
+
+// Returns the highest applied version, or 0 on a database that has never
+// been migrated.
+int current_version(sql::Statement& stmt) {
+  try {
+    std::unique_ptr<sql::ResultSet> res(stmt.executeQuery(
+        "SELECT COALESCE(MAX(version), 0) FROM schema_version"));
+    return res->next() ? res->getInt(1) : 0;
+  } catch (sql::SQLException& e) {
+    if (e.getErrorCode() != kNoSuchTable) throw;
+    return 0;
+  }
+}
+
+}  // namespace
+
+const std::vector<Migration>& schema_migrations() {
+  static const std::vector<Migration> migrations = {
+      {1,
+       "Create users table",
+       {"CREATE TABLE IF NOT EXISTS users ("
+        "IdUser INT AUTO_INCREMENT PRIMARY KEY,"
+        "email VARCHAR(255) UNIQUE NOT NULL,"
+        "username VARCHAR(255) UNIQUE NOT NULL,"
+        "password VARCHAR(255) NOT NULL"
+        ")"}},
+  };
+  return migrations;
+}
+
+int migrate_schema(sql::Connection& conn) {
+  const auto& migrations = schema_migrations();
+  const int latest = migrations.empty() ? 0 : migrations.back().version;
+
+  std::unique_ptr<sql::Statement> stmt(conn.createStatement());
+
+  // Fast path: one query when there is nothing to do
+  int version = current_version(*stmt);
+  if (version >= latest) {
+    LOG_INFO << "Database schema is up to date (version " << version << ")";
+    return version;
+  }
+
+  // Serialize migrations across servers sharing the database. The lock is
+  // tied to this connection and released explicitly below.
+  {
+    std::unique_ptr<sql::ResultSet> lock(stmt->executeQuery(
+        "SELECT GET_LOCK('pokemon_schema_migrations', " +
+        std::to_string(kLockTimeoutSeconds) + ")"));
+    if (!lock->next() || lock->getInt(1) != 1) {
+      throw sql::SQLException("Timed out waiting for the schema migration lock");
+    }
+  }
+
+  try {
+    stmt->execute(
+        "CREATE TABLE IF NOT EXISTS schema_version ("
+        "version INT PRIMARY KEY,"
+        "description VARCHAR(255) NOT NULL,"
+        "applied_at TIMESTAMP NOT NULL DEFAULT CURRENT_TIMESTAMP"
+        ")");
+
+    // Another server may have migrated while we waited for the lock
+    version = current_version(*stmt);
+
+    std::unique_ptr<sql::PreparedStatement> record(conn.prepareStatement(
+        "INSERT INTO schema_version (version, description) VALUES (?, ?)"));
+
+    for (const Migration& migration : migrations) {
+      if (migration.version <= version) continue;
+
+      LOG_INFO << "Applying migration " << migration.version << ": "
+               << migration.description;
+      for (const std::string& statement : migration.statements) {
+        stmt->execute(statement);
+      }
+
+      record->setInt(1, migration.version);
+      record->setString(2, migration.description);
+      record->execute();
+      version = migration.version;
+    }
+  } catch (sql::SQLException&) {
+    try {
+      stmt->execute("DO RELEASE_LOCK('pokemon_schema_migrations')");
+    } catch (sql::SQLException&) {
+      // The server drops the lock with the connection anyway
+    }
+    throw;
+  }
+
+  stmt->execute("DO RELEASE_LOCK('pokemon_schema_migrations')");
+  LOG_INFO << "Database schema migrated to version " << version;
+  return version;
+}
@@ -0,0 +1,131 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the signup group-commit batcher
+
+#include "database/signup_batcher.hpp"
+#include <cppconn/exception.h>
+#include <cppconn/prepared_statement.h>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+#include "database/database_manager.hpp"
+#include "utils/logger.hpp"
+
+SignupBatcher::SignupBatcher(ConnectionPool& pool, const DBConfig& config)
+    : pool(pool),
+      window(config.signup_batch_window_ms),
+      max_size(std::max<std::size_t>(config.signup_batch_max_size, 1)),
+      flusher([this] { flush_loop(); }) {}
+
+SignupBatcher::~SignupBatcher() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_one();
+  flusher.join();
+}
+
+std::future<void> SignupBatcher::submit(const User& user) {
+  std::future<void> result;
+  bool batch_full = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back({user, std::promise<void>(), false});
+    result = pending.back().done.get_future();
+    // Wake the flusher for the first row (to start the window) and when
+    // the batch is full (to flush early)
+    batch_full = pending.size() == 1 || pending.size() >= max_size;
+  }
+  if (batch_full) wake.notify_one();
+  return result;
+}
+
+void SignupBatcher::flush_loop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    wake.wait(lock, [this] { return stopping || !pending.empty(); });
+    if (pending.empty()) return;  // Stopping with nothing left to write
+
+    // Give concurrent signups a short window to join this batch
+    const auto deadline = std::chrono::steady_clock::now() + window;
+    wake.wait_until(lock, deadline, [this] {
+      return stopping || pending.size() >= max_size;
+    });
+
+    std::vector<PendingSignup> batch;
+    const std::size_t count = std::min(pending.size(), max_size);
+    batch.reserve(count);
+    std::move(pending.begin(), pending.begin() + count,
+              std::back_inserter(batch));
+    pending.erase(pending.begin(), pending.begin() + count);
+
+    lock.unlock();
+    write_batch(batch);
+    lock.lock();
+  }
+}
+
+void SignupBatcher::write_batch(std::vector<PendingSignup>& batch) {
+  // Rows that inserted cleanly; their callers are only told once the
+  // transaction has committed
+  std::vector<PendingSignup*> inserted;
+  inserted.reserve(batch.size());
+
+  std::exception_ptr batch_error;
+  try {
+    auto conn = pool.acquire();
+    // No transparent re-prepare here: a reconnect in the middle of the
+    // transaction would silently drop the rows inserted so far
+    sql::PreparedStatement& stmt = conn.prepare(kInsertUserQuery);
+    conn->setAutoCommit(false);
+    try {
+      for (auto& row : batch) {
+        try {
+          stmt.setString(1, row.user.email);
+          stmt.setString(2, row.user.username);
+          stmt.setString(3, row.user.password);
+          stmt.execute();
+          inserted.push_back(&row);
+        } catch (sql::SQLException& e) {
+          // A duplicate only rolls back its own statement; anything else
+          // leaves the transaction in doubt, so abort the whole batch
+          if (e.getErrorCode() != 1062) throw;
+          LOG_ERROR << "Error creating user: " << e.what();
+          row.done.set_exception(
+              std::make_exception_ptr(user_insert_error(e)));
+          row.settled = true;
+        }
+      }
+      conn->commit();
+      conn->setAutoCommit(true);
+    } catch (...) {
+      // Whatever went wrong (lost connection, stale statement), start the
+      // next batch on a fresh connection with a fresh statement cache
+      conn.mark_broken();
+      try {
+        conn->rollback();
+      } catch (sql::SQLException&) {
+        // The connection is being discarded anyway
+      }
+      throw;
+    }
+  } catch (sql::SQLException& e) {
+    LOG_ERROR << "Error writing signup batch: " << e.what();
+    batch_error = std::make_exception_ptr(user_insert_error(e));
+  } catch (...) {
+    // PoolTimeoutError goes back to every waiting caller as is
+    batch_error = std::current_exception();
+  }
+
+  if (batch_error) {
+    // Nothing was committed; every row without an outcome fails
+    for (auto& row : batch) {
+      if (!row.settled) row.done.set_exception(batch_error);
+    }
+    return;
+  }
+
+  for (auto* row : inserted) row->done.set_value();
+}
@@ -0,0 +1,39 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Selects the storage backend configured in the .env file
+
+#include "database/storage_backend.hpp"
+#include <stdexcept>
+#include <string>
+
+#include "database/in_memory_storage.hpp"
+#include "utils/env.hpp"
+#include "utils/logger.hpp"
+
+#ifdef BACKEND_WITH_MYSQL
+#include "database/database_manager.hpp"
+#endif
+
+std::unique_ptr<StorageBackend> make_storage_backend() {
+#ifdef BACKEND_WITH_MYSQL
+  const std::string kind = EnvLoader::getEnvVariable("STORAGE_BACKEND", "mysql");
+#else
+  const std::string kind = EnvLoader::getEnvVariable("STORAGE_BACKEND", "memory");
+#endif
+
+  if (kind == "memory") {
+    LOG_INFO << "Using in-memory storage; data will not be persisted";
+    return std::make_unique<InMemoryStorage>();
+  }
+
+  if (kind == "mysql") {
+#ifdef BACKEND_WITH_MYSQL
+    return std::make_unique<DatabaseManager>();
+#else
+    throw std::runtime_error(
+        "STORAGE_BACKEND=mysql but the server was built without MySQL "
+        "support");
+#endif
+  }
+
+  throw std::runtime_error("Unknown STORAGE_BACKEND: " + kind);
+}
@@ -0,0 +1,44 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the username/email existence index
+
+#include "database/user_index.hpp"
+#include <mutex>
+
+void UserIndex::add(const std::string& username, const std::string& email) {
+  usernames.insert(username);
+  emails.insert(email);
+}
+
+bool UserIndex::has_username(const std::string& username) const {
+  return usernames.contains(username);
+}
+
+bool UserIndex::has_email(const std::string& email) const {
+  return emails.contains(email);
+}
+
+UserIndexStats UserIndex::stats() const {
+  return {usernames.size(), emails.size(),
+          rejected.load(std::memory_order_relaxed)};
+}
+
+void UserIndex::ShardedSet::insert(const std::string& value) {
+  Shard& shard = shard_for(value);
+  std::unique_lock<std::shared_mutex> lock(shard.mutex);
+  shard.values.insert(value);
+}
+
+bool UserIndex::ShardedSet::contains(const std::string& value) const {
+  const Shard& shard = shard_for(value);
+  std::shared_lock<std::shared_mutex> lock(shard.mutex);
+  return shard.values.count(value) > 0;
+}
+
+std::size_t UserIndex::ShardedSet::size() const {
+  std::size_t total = 0;
+  for (const Shard& shard : shards) {
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    total += shard.values.size();
+  }
+  return total;
+}
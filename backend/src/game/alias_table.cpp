@@ -0,0 +1,46 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Construction of the alias tables
+
+#include "game/alias_table.hpp"
+#include <stdexcept>
+
+AliasTable::AliasTable(const std::vector<std::uint32_t>& weights) {
+  const std::size_t n = weights.size();
+  if (n == 0 || n > 65536) {
+    throw std::invalid_argument("Alias table needs 1 to 65536 weights");
+  }
+  std::uint64_t sum = 0;
+  for (std::uint32_t weight : weights) sum += weight;
+  if (sum == 0 || sum > UINT32_MAX) {
+    throw std::invalid_argument("Alias table weights must sum to 1..2^32-1");
+  }
+  total = static_cast<std::uint32_t>(sum);
+
+  // Scale every weight by n so a column's share is exactly total; columns
+  // under it (small) are topped up by an alias from one over it (large)
+  std::vector<std::uint64_t> scaled(n);
+  std::vector<std::uint32_t> small;
+  std::vector<std::uint32_t> large;
+  for (std::size_t i = 0; i < n; ++i) {
+    scaled[i] = std::uint64_t{weights[i]} * n;
+    (scaled[i] < total ? small : large)
+        .push_back(static_cast<std::uint32_t>(i));
+  }
+
+  // Columns left over at the end hold exactly total and pick themselves
+  columns.resize(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    columns[i] = {total, static_cast<std::uint32_t>(i)};
+  }
+  while (!small.empty() && !large.empty()) {
+    const std::uint32_t less = small.back();
+    small.pop_back();
+    const std::uint32_t more = large.back();
+    columns[less] = {static_cast<std::uint32_t>(scaled[less]), more};
+    scaled[more] -= total - scaled[less];
+    if (scaled[more] < total) {
+      large.pop_back();
+      small.push_back(more);
+    }
+  }
+}
@@ -0,0 +1,85 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the encounter tables
+
+#include "game/encounter_table.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace {
+
+std::vector<std::uint32_t> weights_of(const std::vector<Encounter>& rows) {
+  std::vector<std::uint32_t> weights;
+  weights.reserve(rows.size());
+  for (const Encounter& row : rows) weights.push_back(row.weight);
+  return weights;
+}
+
+}  // namespace
+
+EncounterTable::EncounterTable(std::vector<Encounter> encounters)
+    : entries(std::move(encounters)), alias(weights_of(entries)) {
+  std::uint64_t sum = 0;
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    const Encounter& row = entries[i];
+    if (row.species == 0 || row.weight == 0 || row.min_level == 0 ||
+        row.min_level > row.max_level) {
+      throw std::invalid_argument("Invalid encounter for species " +
+                                  std::to_string(row.species));
+    }
+    if (row.species >= row_of.size()) row_of.resize(row.species + 1, kAbsent);
+    if (row_of[row.species] != kAbsent) {
+      throw std::invalid_argument("Species " + std::to_string(row.species) +
+                                  " is listed twice in one encounter table");
+    }
+    row_of[row.species] = static_cast<std::uint16_t>(i);
+    sum += row.weight;
+    prefix.push_back(sum);
+  }
+}
+
+const Encounter* EncounterTable::draw(
+    Random& rng, std::span<const std::uint16_t> present) const {
+  const Encounter& row = entries[alias.sample(rng)];
+  const bool out = std::find(present.begin(), present.end(), row.species) !=
+                   present.end();
+  if (!out) return &row;
+  return draw_excluding(rng, present);
+}
+
+const Encounter* EncounterTable::draw_excluding(
+    Random& rng, std::span<const std::uint16_t> present) const {
+  // Rows of this table that are out, in ascending order. Reused between
+  // draws so the fallback does not allocate.
+  thread_local std::vector<std::uint16_t> excluded;
+  excluded.clear();
+  std::uint64_t weight = prefix.back();
+  for (std::uint16_t species : present) {
+    if (species >= row_of.size() || row_of[species] == kAbsent) continue;
+    const std::uint16_t row = row_of[species];
+    if (std::find(excluded.begin(), excluded.end(), row) != excluded.end()) {
+      continue;
+    }
+    excluded.push_back(row);
+    weight -= entries[row].weight;
+  }
+  if (weight == 0) return nullptr;
+  std::sort(excluded.begin(), excluded.end());
+
+  // Draw a point on the weight line with the excluded rows cut out, then
+  // map it back onto the full line: every excluded row at or before the
+  // point found pushes it right by that row's weight.
+  std::uint64_t point = rng.below(static_cast<std::uint32_t>(weight));
+  auto find_row = [this](std::uint64_t at) {
+    return static_cast<std::size_t>(
+        std::upper_bound(prefix.begin(), prefix.end(), at) - prefix.begin());
+  };
+  std::size_t row = find_row(point);
+  for (std::uint16_t skip : excluded) {
+    if (skip > row) break;
+    point += entries[skip].weight;
+    row = find_row(point);
+  }
+  return &entries[row];
+}
@@ -0,0 +1,301 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the game channel
+
+#include "game/game_channel.hpp"
+#include <string_view>
+#include <utility>
+
+namespace {
+
+enum MessageType : std::uint8_t {
+  kEnter = 0x01,
+  kMove = 0x02,
+  kEntered = 0x81,
+  kSpawns = 0x82,
+  kPlayers = 0x83,
+  kError = 0x84,
+};
+
+enum ErrorCode : std::uint8_t {
+  kBadMessage = 1,
+  kZoneNotFound = 2,
+  kNotInZone = 3,
+  kBusy = 4,
+};
+
+// Replies waiting for a client that does not read are capped at this
+constexpr std::size_t kOutboxLimit = 1024;
+
+void put_u8(std::string& out, std::uint8_t value) {
+  out.push_back(static_cast<char>(value));
+}
+
+void put_u16(std::string& out, std::uint16_t value) {
+  put_u8(out, static_cast<std::uint8_t>(value));
+  put_u8(out, static_cast<std::uint8_t>(value >> 8));
+}
+
+void put_u32(std::string& out, std::uint32_t value) {
+  put_u16(out, static_cast<std::uint16_t>(value));
+  put_u16(out, static_cast<std::uint16_t>(value >> 16));
+}
+
+// Reads fixed-width little-endian fields from a received frame; every
+// read fails once the frame runs out
+class Reader {
+ public:
+  explicit Reader(std::string_view data) : data(data) {}
+
+  bool done() const { return data.empty(); }
+
+  bool u8(std::uint8_t& value) {
+    if (data.empty()) return false;
+    value = static_cast<std::uint8_t>(data.front());
+    data.remove_prefix(1);
+    return true;
+  }
+
+  bool u32(std::uint32_t& value) {
+    if (data.size() < 4) return false;
+    value = 0;
+    for (int i = 3; i >= 0; --i) {
+      value = value << 8 | static_cast<std::uint8_t>(data[i]);
+    }
+    data.remove_prefix(4);
+    return true;
+  }
+
+ private:
+  std::string_view data;
+};
+
+}  // namespace
+
+GameChannel::GameChannel(const SpawnEngine& spawns, MovementEngine& movement,
+                         std::size_t send_limit, std::uint32_t stall_ticks)
+    : spawn_engine(spawns),
+      movement(movement),
+      send_limit(send_limit),
+      stall_ticks(stall_ticks),
+      snapshots(movement.zone_count()) {}
+
+GameChannel::~GameChannel() {
+  for (Session* session : sessions) {
+    session->connection->userdata(nullptr);
+    delete session;
+  }
+}
+
+void* GameChannel::accept(std::string username, std::string session_id) {
+  Session* session = new Session;
+  session->username = std::move(username);
+  session->session_id = std::move(session_id);
+  return session;
+}
+
+void GameChannel::open(crow::websocket::connection& connection) {
+  auto* session = static_cast<Session*>(connection.userdata());
+  std::unique_lock<std::shared_mutex> lock(sessions_mutex);
+  session->connection = &connection;
+  session->index = sessions.size();
+  sessions.push_back(session);
+}
+
+void GameChannel::close(crow::websocket::connection& connection) {
+  auto* session = static_cast<Session*>(connection.userdata());
+  if (!session) return;
+  {
+    std::unique_lock<std::shared_mutex> lock(sessions_mutex);
+    connection.userdata(nullptr);
+
+    // Closed before it opened if it was never registered
+    if (session->connection) {
+      sessions[session->index] = sessions.back();
+      sessions[session->index]->index = session->index;
+      sessions.pop_back();
+    }
+  }
+  // Leaves the player in place if another connection or an HTTP request
+  // has entered it since
+  if (session->zone != kNoZone) {
+    movement.leave(session->username, session->ticket);
+  }
+  delete session;
+}
+
+void GameChannel::reply_error(Session& session, std::uint8_t code) {
+  if (session.outbox.size() + 2 > kOutboxLimit) {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  put_u8(session.outbox, kError);
+  put_u8(session.outbox, code);
+}
+
+void GameChannel::message(crow::websocket::connection& connection,
+                          const std::string& data, bool is_binary) {
+  auto* session = static_cast<Session*>(connection.userdata());
+  if (!session) return;
+  std::lock_guard<std::mutex> lock(session->mutex);
+  if (!is_binary) {
+    bad_messages.fetch_add(1, std::memory_order_relaxed);
+    reply_error(*session, kBadMessage);
+    return;
+  }
+
+  Reader reader(data);
+  while (!reader.done()) {
+    messages.fetch_add(1, std::memory_order_relaxed);
+    std::uint8_t type = 0;
+    std::uint32_t zone = 0;
+    std::uint8_t direction = 0;
+    reader.u8(type);
+
+    if (type == kEnter && reader.u32(zone)) {
+      if (zone >= movement.zone_count()) {
+        reply_error(*session, kZoneNotFound);
+        continue;
+      }
+      const ZoneEntry entry = movement.enter(session->username, zone);
+      session->zone = zone;
+      session->ticket = entry.ticket;
+      session->spawns_sent = kNever;
+      session->players_sent = kNever;
+      if (session->outbox.size() + 9 > kOutboxLimit) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+      put_u8(session->outbox, kEntered);
+      put_u32(session->outbox, zone);
+      put_u32(session->outbox, entry.player);
+    } else if (type == kMove && reader.u8(direction) && direction <= 3) {
+      switch (movement.submit(session->username, session->zone,
+                              static_cast<Direction>(direction))) {
+        case MoveStatus::kQueued:
+          break;
+        case MoveStatus::kNotInZone:
+          reply_error(*session, kNotInZone);
+          break;
+        case MoveStatus::kBusy:
+          reply_error(*session, kBusy);
+          break;
+      }
+    } else {
+      // The rest of the frame cannot be framed reliably; drop it
+      bad_messages.fetch_add(1, std::memory_order_relaxed);
+      reply_error(*session, kBadMessage);
+      return;
+    }
+  }
+}
+
+void GameChannel::end_session(const std::string& session_id) {
+  std::shared_lock<std::shared_mutex> lock(sessions_mutex);
+  for (Session* session : sessions) {
+    if (session->session_id == session_id &&
+        !session->closing.exchange(true, std::memory_order_relaxed)) {
+      session->connection->close("Logged out");
+    }
+  }
+}
+
+const GameChannel::Snapshot& GameChannel::snapshot(std::uint32_t zone) {
+  Snapshot& cached = snapshots[zone];
+  if (cached.flush == flushes) return cached;
+  const bool fresh = cached.flush == 0;
+  cached.flush = flushes;
+
+  const std::uint64_t spawns_changed =
+      spawn_engine.spawns(zone, spawn_scratch);
+  if (fresh || spawns_changed != cached.spawns_changed) {
+    cached.spawns_changed = spawns_changed;
+    cached.spawns.clear();
+    put_u8(cached.spawns, kSpawns);
+    put_u32(cached.spawns, static_cast<std::uint32_t>(spawns_changed));
+    put_u16(cached.spawns, static_cast<std::uint16_t>(spawn_scratch.size()));
+    for (const Spawn& spawn : spawn_scratch) {
+      put_u16(cached.spawns, spawn.species);
+      put_u8(cached.spawns, spawn.level);
+      put_u16(cached.spawns, spawn.x);
+      put_u16(cached.spawns, spawn.y);
+    }
+  }
+
+  const std::uint64_t players_changed =
+      movement.players(zone, player_scratch);
+  if (fresh || players_changed != cached.players_changed) {
+    cached.players_changed = players_changed;
+    cached.players.clear();
+    put_u8(cached.players, kPlayers);
+    put_u32(cached.players, static_cast<std::uint32_t>(players_changed));
+    put_u16(cached.players,
+            static_cast<std::uint16_t>(player_scratch.size()));
+    for (const PlayerPosition& player : player_scratch) {
+      put_u32(cached.players, player.player);
+      put_u16(cached.players, player.x);
+      put_u16(cached.players, player.y);
+    }
+  }
+  return cached;
+}
+
+void GameChannel::flush() {
+  ++flushes;
+  std::uint64_t sent_frames = 0;
+  std::uint64_t sent_bytes = 0;
+
+  std::shared_lock<std::shared_mutex> lock(sessions_mutex);
+  for (Session* session : sessions) {
+    if (session->closing.load(std::memory_order_relaxed)) continue;
+
+    // Backpressure: leave the state owed for a later tick
+    if (session->connection->buffered_amount() > send_limit) {
+      deferred.fetch_add(1, std::memory_order_relaxed);
+      if (++session->stalled > stall_ticks &&
+          !session->closing.exchange(true, std::memory_order_relaxed)) {
+        closed_slow.fetch_add(1, std::memory_order_relaxed);
+        session->connection->close("Too slow");
+      }
+      continue;
+    }
+    session->stalled = 0;
+
+    std::lock_guard<std::mutex> session_lock(session->mutex);
+    frame.clear();
+    frame.swap(session->outbox);
+    if (session->zone != kNoZone) {
+      const Snapshot& zone = snapshot(session->zone);
+      if (zone.spawns_changed != session->spawns_sent) {
+        frame += zone.spawns;
+        session->spawns_sent = zone.spawns_changed;
+      }
+      if (zone.players_changed != session->players_sent) {
+        frame += zone.players;
+        session->players_sent = zone.players_changed;
+      }
+    }
+    if (frame.empty()) continue;
+    sent_bytes += frame.size();
+    ++sent_frames;
+    session->connection->send_binary(frame);
+  }
+
+  frames.fetch_add(sent_frames, std::memory_order_relaxed);
+  bytes.fetch_add(sent_bytes, std::memory_order_relaxed);
+}
+
+GameChannelStats GameChannel::stats() const {
+  std::size_t connections;
+  {
+    std::shared_lock<std::shared_mutex> lock(sessions_mutex);
+    connections = sessions.size();
+  }
+  return {connections,
+          frames.load(std::memory_order_relaxed),
+          bytes.load(std::memory_order_relaxed),
+          messages.load(std::memory_order_relaxed),
+          bad_messages.load(std::memory_order_relaxed),
+          deferred.load(std::memory_order_relaxed),
+          closed_slow.load(std::memory_order_relaxed),
+          dropped.load(std::memory_order_relaxed)};
+}
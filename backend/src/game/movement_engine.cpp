@@ -0,0 +1,291 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the movement engine
+
+#include "game/movement_engine.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+std::optional<Direction> parse_direction(std::string_view name) {
+  if (name == "up") return Direction::kUp;
+  if (name == "down") return Direction::kDown;
+  if (name == "left") return Direction::kLeft;
+  if (name == "right") return Direction::kRight;
+  return std::nullopt;
+}
+
+MovementEngine::Zone::Zone(const ZoneTemplate& rules)
+    : rules(&rules), grid(rules.width, rules.height) {}
+
+MovementEngine::MovementEngine(const std::vector<ZoneGroup>& groups,
+                               std::size_t queue_capacity)
+    : inputs(queue_capacity) {
+  std::size_t total = 0;
+  for (const ZoneGroup& group : groups) {
+    group.zone.validate();
+    total += group.instances;
+  }
+
+  // Zones point at their template, so neither vector may reallocate
+  templates.reserve(groups.size());
+  zones.reserve(total);
+  for (const ZoneGroup& group : groups) {
+    templates.push_back(group.zone);
+    for (std::size_t i = 0; i < group.instances; ++i) {
+      zones.emplace_back(templates.back());
+    }
+  }
+}
+
+ZoneEntry MovementEngine::enter(const std::string& name, std::size_t zone) {
+  std::unique_lock<std::shared_mutex> lock(directory_mutex);
+  auto [it, added] = directory.try_emplace(name);
+  Membership& member = it->second;
+  if (added) {
+    if (free_ids.empty()) {
+      member.player = static_cast<std::uint32_t>(generations.size());
+      generations.push_back(0);
+    } else {
+      member.player = free_ids.back();
+      free_ids.pop_back();
+    }
+    member.generation = ++generations[member.player];
+  }
+  member.zone = static_cast<std::uint32_t>(zone);
+  member.ticket = ++tickets;
+
+  // Queued under the directory lock so the tick sees changes to one
+  // player in the order the directory made them
+  std::lock_guard<std::mutex> queue_lock(membership_mutex);
+  memberships.push_back(member);
+  return {member.player, member.ticket};
+}
+
+bool MovementEngine::leave(const std::string& name) {
+  return leave(name, 0);
+}
+
+bool MovementEngine::leave(const std::string& name, std::uint64_t ticket) {
+  std::unique_lock<std::shared_mutex> lock(directory_mutex);
+  auto it = directory.find(name);
+  if (it == directory.end()) return false;
+  if (ticket != 0 && it->second.ticket != ticket) return false;
+  const Membership& member = it->second;
+  {
+    std::lock_guard<std::mutex> queue_lock(membership_mutex);
+    memberships.push_back({member.player, member.generation, kNoZone});
+  }
+  free_ids.push_back(member.player);
+  directory.erase(it);
+  return true;
+}
+
+MoveStatus MovementEngine::submit(const std::string& name, std::size_t zone,
+                                  Direction direction) {
+  Input input;
+  {
+    std::shared_lock<std::shared_mutex> lock(directory_mutex);
+    auto it = directory.find(name);
+    if (it == directory.end() || it->second.zone != zone) {
+      return MoveStatus::kNotInZone;
+    }
+    input = {it->second.player, it->second.generation, it->second.zone,
+             direction};
+  }
+  if (!inputs.push(input)) {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return MoveStatus::kBusy;
+  }
+  return MoveStatus::kQueued;
+}
+
+bool MovementEngine::occupied(const Zone& zone, int x, int y) const {
+  bool found = false;
+  zone.grid.for_each_in_rect(x, y, x, y,
+                             [&found](const GridEntry&) { found = true; });
+  return found;
+}
+
+void MovementEngine::touch(std::uint32_t zone_index) {
+  Zone& zone = zones[zone_index];
+  if (!zone.dirty) {
+    zone.dirty = true;
+    dirty_zones.push_back(zone_index);
+  }
+}
+
+void MovementEngine::join(std::uint32_t id, std::uint32_t zone_index) {
+  Zone& zone = zones[zone_index];
+  const ZoneTemplate& rules = *zone.rules;
+
+  // The free tile nearest the entry, ring by ring around it
+  const int entry_x = rules.entry_x;
+  const int entry_y = rules.entry_y;
+  const int rings = std::max(rules.width, rules.height);
+  for (int ring = 0; ring < rings; ++ring) {
+    for (int y = entry_y - ring; y <= entry_y + ring; ++y) {
+      for (int x = entry_x - ring; x <= entry_x + ring; ++x) {
+        if (std::max(std::abs(x - entry_x), std::abs(y - entry_y)) != ring ||
+            x < 0 || y < 0 ||
+            !rules.walkable(static_cast<std::uint16_t>(x),
+                            static_cast<std::uint16_t>(y)) ||
+            occupied(zone, x, y)) {
+          continue;
+        }
+        Player& player = roster[id];
+        player.zone = zone_index;
+        player.slot = static_cast<std::uint32_t>(zone.members.size());
+        player.x = static_cast<std::uint16_t>(x);
+        player.y = static_cast<std::uint16_t>(y);
+        zone.members.push_back(id);
+        zone.grid.insert(player.slot, player.x, player.y);
+        player_count.fetch_add(1, std::memory_order_relaxed);
+        touch(zone_index);
+        return;
+      }
+    }
+  }
+}
+
+void MovementEngine::depart(Player& player) {
+  Zone& zone = zones[player.zone];
+  touch(player.zone);
+
+  // Keep slots dense: the last member takes over the leaver's slot
+  const auto last = static_cast<std::uint32_t>(zone.members.size() - 1);
+  zone.grid.remove(player.slot);
+  if (player.slot != last) {
+    const std::uint32_t moved = zone.members[last];
+    Player& other = roster[moved];
+    zone.grid.remove(last);
+    zone.grid.insert(player.slot, other.x, other.y);
+    other.slot = player.slot;
+    zone.members[player.slot] = moved;
+  }
+  zone.members.pop_back();
+  player.zone = kNoZone;
+  player_count.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void MovementEngine::apply(const Membership& change) {
+  if (change.player >= roster.size()) roster.resize(change.player + 1);
+  Player& player = roster[change.player];
+  if (player.zone != kNoZone) depart(player);
+  player.generation = change.generation;
+  if (change.zone != kNoZone) join(change.player, change.zone);
+}
+
+bool MovementEngine::step(Player& player, Direction direction) {
+  int x = player.x;
+  int y = player.y;
+  switch (direction) {
+    case Direction::kUp:    --y; break;
+    case Direction::kDown:  ++y; break;
+    case Direction::kLeft:  --x; break;
+    case Direction::kRight: ++x; break;
+  }
+  Zone& zone = zones[player.zone];
+  if (x < 0 || y < 0 ||
+      !zone.rules->walkable(static_cast<std::uint16_t>(x),
+                            static_cast<std::uint16_t>(y)) ||
+      occupied(zone, x, y)) {
+    return false;
+  }
+  player.x = static_cast<std::uint16_t>(x);
+  player.y = static_cast<std::uint16_t>(y);
+  zone.grid.move(player.slot, player.x, player.y);
+  touch(player.zone);
+  return true;
+}
+
+std::size_t MovementEngine::tick() {
+  ++current;
+
+  {
+    std::lock_guard<std::mutex> lock(membership_mutex);
+    pending_memberships.swap(memberships);
+  }
+  for (const Membership& change : pending_memberships) apply(change);
+  pending_memberships.clear();
+
+  // At most one queue's worth, so producers that keep pushing cannot
+  // stretch the tick
+  std::uint64_t late = 0;
+  batch.clear();
+  Input input;
+  for (std::size_t n = inputs.capacity(); n > 0 && inputs.pop(input); --n) {
+    const Player* player =
+        input.player < roster.size() ? &roster[input.player] : nullptr;
+    if (player && player->generation == input.generation &&
+        player->zone == input.zone) {
+      batch.push_back(input);
+    } else {
+      ++late;  // Left or changed zone after queuing it
+    }
+  }
+
+  // One pass zone by zone, keeping arrival order within each zone
+  std::stable_sort(
+      batch.begin(), batch.end(),
+      [](const Input& a, const Input& b) { return a.zone < b.zone; });
+  std::uint64_t moved = 0;
+  std::uint64_t stopped = 0;
+  for (const Input& next : batch) {
+    Player& player = roster[next.player];
+    if (player.moved == current) {
+      ++late;
+      continue;
+    }
+    player.moved = current;
+    if (step(player, next.direction)) {
+      ++moved;
+    } else {
+      ++stopped;
+    }
+  }
+
+  publish();
+  steps.fetch_add(moved, std::memory_order_relaxed);
+  blocked.fetch_add(stopped, std::memory_order_relaxed);
+  stale.fetch_add(late, std::memory_order_relaxed);
+  return moved + stopped;
+}
+
+void MovementEngine::publish() {
+  for (std::uint32_t index : dirty_zones) {
+    Zone& zone = zones[index];
+    zone.scratch.clear();
+    for (std::uint32_t id : zone.members) {
+      const Player& player = roster[id];
+      zone.scratch.push_back({id, player.x, player.y});
+    }
+  }
+
+  std::unique_lock<std::shared_mutex> lock(publish_mutex);
+  for (std::uint32_t index : dirty_zones) {
+    Zone& zone = zones[index];
+    zone.published.swap(zone.scratch);
+    zone.changed = current;
+    zone.dirty = false;
+  }
+  dirty_zones.clear();
+  published_tick.store(current, std::memory_order_relaxed);
+}
+
+std::uint64_t MovementEngine::players(std::size_t zone,
+                                      std::vector<PlayerPosition>& out) const {
+  std::shared_lock<std::shared_mutex> lock(publish_mutex);
+  const Zone& instance = zones[zone];
+  out.assign(instance.published.begin(), instance.published.end());
+  return instance.changed;
+}
+
+MovementStats MovementEngine::stats() const {
+  return {player_count.load(std::memory_order_relaxed),
+          published_tick.load(std::memory_order_relaxed),
+          steps.load(std::memory_order_relaxed),
+          blocked.load(std::memory_order_relaxed),
+          stale.load(std::memory_order_relaxed),
+          dropped.load(std::memory_order_relaxed),
+          inputs.capacity()};
+}
@@ -0,0 +1,89 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the spatial grid
+
+#include "game/spatial_grid.hpp"
+#include <stdexcept>
+#include <string>
+
+SpatialGrid::SpatialGrid(std::uint16_t width, std::uint16_t height,
+                         unsigned cell_bits)
+    : map_width(width), map_height(height), cell_bits(cell_bits) {
+  if (width == 0 || height == 0 || cell_bits > 15) {
+    throw std::invalid_argument("Spatial grid needs a non-empty map and "
+                                "cells of at most 2^15 tiles");
+  }
+  columns = ((width - 1u) >> cell_bits) + 1;
+  const std::uint32_t rows = ((height - 1u) >> cell_bits) + 1;
+  cells.resize(std::size_t{columns} * rows);
+}
+
+void SpatialGrid::check_on_map(std::uint16_t x, std::uint16_t y) const {
+  if (x >= map_width || y >= map_height) {
+    throw std::invalid_argument("Tile (" + std::to_string(x) + ", " +
+                                std::to_string(y) + ") is off the map");
+  }
+}
+
+void SpatialGrid::insert(std::uint32_t id, std::uint16_t x,
+                         std::uint16_t y) {
+  check_on_map(x, y);
+  if (contains(id)) {
+    throw std::invalid_argument("Entity " + std::to_string(id) +
+                                " is already in the grid");
+  }
+  if (id >= where.size()) where.resize(std::size_t{id} + 1);
+
+  const std::uint32_t cell = cell_of(x, y);
+  std::vector<GridEntry>& entries = cells[cell];
+  where[id] = {cell, static_cast<std::uint32_t>(entries.size())};
+  entries.push_back({id, x, y});
+  ++count;
+}
+
+void SpatialGrid::unlink(const Location& location) {
+  // Swap the last entry of the cell into the hole, so arrays stay dense
+  std::vector<GridEntry>& entries = cells[location.cell];
+  if (location.slot + 1 != entries.size()) {
+    entries[location.slot] = entries.back();
+    where[entries[location.slot].id].slot = location.slot;
+  }
+  entries.pop_back();
+}
+
+bool SpatialGrid::remove(std::uint32_t id) {
+  if (!contains(id)) return false;
+  unlink(where[id]);
+  where[id].cell = kAbsent;
+  --count;
+  return true;
+}
+
+void SpatialGrid::move(std::uint32_t id, std::uint16_t x, std::uint16_t y) {
+  check_on_map(x, y);
+  if (!contains(id)) {
+    throw std::invalid_argument("Entity " + std::to_string(id) +
+                                " is not in the grid");
+  }
+  Location& location = where[id];
+  const std::uint32_t cell = cell_of(x, y);
+  if (cell == location.cell) {
+    GridEntry& entry = cells[cell][location.slot];
+    entry.x = x;
+    entry.y = y;
+    return;
+  }
+  unlink(location);
+  std::vector<GridEntry>& entries = cells[cell];
+  location = {cell, static_cast<std::uint32_t>(entries.size())};
+  entries.push_back({id, x, y});
+}
+
+std::size_t SpatialGrid::bytes() const {
+  std::size_t total = sizeof(*this) +
+                      cells.capacity() * sizeof(std::vector<GridEntry>) +
+                      where.capacity() * sizeof(Location);
+  for (const std::vector<GridEntry>& entries : cells) {
+    total += entries.capacity() * sizeof(GridEntry);
+  }
+  return total;
+}
@@ -0,0 +1,152 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the spawn engine
+
+#include "game/spawn_engine.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+SpawnEngine::SpawnEngine(std::vector<ZoneGroup> groups, std::uint64_t seed)
+    : rng(seed) {
+  std::size_t zone_total = 0;
+  std::size_t slot_total = 0;
+  for (const ZoneGroup& group : groups) {
+    group.zone.validate();
+    zone_total += group.instances;
+    slot_total += group.instances * group.zone.areas.size();
+  }
+  if (slot_total > std::numeric_limits<std::uint32_t>::max()) {
+    throw std::invalid_argument("Too many spawn areas");
+  }
+  zones.reserve(zone_total);
+  slots.resize(slot_total);
+  templates.reserve(groups.size());
+
+  std::uint32_t next_slot = 0;
+  for (ZoneGroup& group : groups) {
+    const auto group_index = static_cast<std::uint32_t>(templates.size());
+    templates.push_back(std::move(group.zone));
+    const ZoneTemplate& zone = templates.back();
+    first_table.push_back(static_cast<std::uint32_t>(tables.size()));
+    for (const SpawnArea& area : zone.areas) {
+      tables.emplace_back(area.encounters);
+    }
+    for (std::size_t i = 0; i < group.instances; ++i) {
+      const auto zone_index = static_cast<std::uint32_t>(zones.size());
+      zones.push_back({group_index, next_slot});
+      for (std::size_t area = 0; area < zone.areas.size(); ++area) {
+        Slot& slot = slots[next_slot++];
+        slot.zone = zone_index;
+        slot.area = static_cast<std::uint16_t>(area);
+        schedule_spawn(slot, zone);
+      }
+    }
+  }
+}
+
+void SpawnEngine::schedule_spawn(Slot& slot, const ZoneTemplate& zone) {
+  // Ticks until the first successful roll: geometric with p = spawn_chance
+  std::uint64_t delay = 1;
+  if (zone.spawn_chance < 1) {
+    // u is in (0, 1], so the logarithm is finite
+    const double u = 1.0 - rng.unit();
+    const double extra =
+        std::floor(std::log(u) / std::log1p(-zone.spawn_chance));
+    delay += static_cast<std::uint64_t>(std::min(extra, 1e12));
+  }
+  wheel.schedule(&slot, wheel.now() + delay);
+}
+
+bool SpawnEngine::place(Slot& slot, const ZoneTemplate& zone) {
+  const Zone& owner = zones[slot.zone];
+  const Slot* first = &slots[owner.first_slot];
+  present.clear();
+  for (const Slot* other = first; other != first + zone.areas.size();
+       ++other) {
+    if (other->species != 0) present.push_back(other->species);
+  }
+
+  const EncounterTable& table = tables[first_table[owner.group] + slot.area];
+  const Encounter* encounter = table.draw(rng, present);
+  if (!encounter) return false;
+
+  const SpawnArea& area = zone.areas[slot.area];
+  slot.species = encounter->species;
+  slot.level = static_cast<std::uint8_t>(
+      rng.between(encounter->min_level, encounter->max_level));
+  slot.x =
+      static_cast<std::uint16_t>(rng.between(area.start_x, area.end_x - 1));
+  slot.y =
+      static_cast<std::uint16_t>(rng.between(area.start_y, area.end_y - 1));
+  return true;
+}
+
+void SpawnEngine::fire(Slot& slot) {
+  Zone& zone = zones[slot.zone];
+  const ZoneTemplate& rules = templates[zone.group];
+
+  if (slot.species != 0) {
+    zone.changed = wheel.now();
+    slot.species = 0;
+    --live;
+    ++despawned;
+    schedule_spawn(slot, rules);
+    return;
+  }
+
+  if (!place(slot, rules)) {
+    // Nothing new can appear here until something leaves; roll again later
+    schedule_spawn(slot, rules);
+    return;
+  }
+  zone.changed = wheel.now();
+  ++live;
+  ++spawned;
+  wheel.schedule(&slot, wheel.now() + rng.between(rules.min_lifetime,
+                                                  rules.max_lifetime));
+}
+
+std::size_t SpawnEngine::tick() {
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  std::size_t events = 0;
+  wheel.advance(wheel.now() + 1, [this, &events](TimerNode* node) {
+    fire(*static_cast<Slot*>(node));
+    ++events;
+  });
+  return events;
+}
+
+std::uint64_t SpawnEngine::now() const {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  return wheel.now();
+}
+
+std::uint64_t SpawnEngine::spawns(std::size_t zone,
+                                  std::vector<Spawn>& out) const {
+  out.clear();
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  const Zone& instance = zones[zone];
+  const std::size_t areas = templates[instance.group].areas.size();
+  for (std::size_t i = 0; i < areas; ++i) {
+    const Slot& slot = slots[instance.first_slot + i];
+    if (slot.species != 0) {
+      out.push_back({slot.species, slot.x, slot.y, slot.level});
+    }
+  }
+  return instance.changed;
+}
+
+SpawnEngineStats SpawnEngine::stats() const {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  std::size_t bytes = sizeof(*this) + zones.capacity() * sizeof(Zone) +
+                      slots.capacity() * sizeof(Slot);
+  for (const ZoneTemplate& zone : templates) {
+    bytes += sizeof(zone) + zone.areas.capacity() * sizeof(SpawnArea);
+  }
+  bytes += tables.capacity() * sizeof(EncounterTable);
+  return {zones.size(), slots.size(), live, wheel.now(), spawned, despawned,
+          bytes};
+}
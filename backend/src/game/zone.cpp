@@ -0,0 +1,100 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the zone templates
+
+#include "game/zone.hpp"
+#include <stdexcept>
+#include <string>
+
+void ZoneTemplate::validate() const {
+  for (const SpawnArea& area : areas) {
+    if (area.start_x >= area.end_x || area.start_y >= area.end_y ||
+        area.end_x > width || area.end_y > height) {
+      throw std::invalid_argument("Zone " + name +
+                                  " has an empty or off-map spawn area");
+    }
+  }
+  if (!tiles.empty() && tiles.size() != std::size_t{width} * height) {
+    throw std::invalid_argument("Zone " + name + " needs " +
+                                std::to_string(width * height) + " tiles");
+  }
+  if (!walkable(entry_x, entry_y)) {
+    throw std::invalid_argument("Zone " + name + " has a blocked entry");
+  }
+  if (!(spawn_chance > 0 && spawn_chance <= 1)) {
+    throw std::invalid_argument("Zone " + name +
+                                " needs a spawn chance in (0, 1]");
+  }
+  if (min_lifetime == 0 || min_lifetime > max_lifetime) {
+    throw std::invalid_argument("Zone " + name + " has an invalid lifetime");
+  }
+}
+
+ZoneTemplate meadow_zone() {
+  return ZoneTemplate{
+      "meadow",
+      26,
+      26,
+      {
+          // Tall grass along the top path
+          {2, 9, 12, 12,
+           {{16, 45, 2, 5},     // Pidgey
+            {19, 40, 2, 4},     // Rattata
+            {21, 10, 3, 5},     // Spearow
+            {25, 5, 3, 5}}},    // Pikachu
+          // Forest edge
+          {19, 17, 24, 23,
+           {{10, 35, 3, 5},     // Caterpie
+            {13, 35, 3, 5},     // Weedle
+            {11, 10, 4, 6},     // Metapod
+            {14, 10, 4, 6},     // Kakuna
+            {43, 8, 5, 8},      // Oddish
+            {1, 2, 5, 5}}},     // Bulbasaur
+          // River bank
+          {3, 13, 7, 26,
+           {{60, 35, 4, 8},     // Poliwag
+            {54, 25, 5, 8},     // Psyduck
+            {129, 25, 5, 10},   // Magikarp
+            {118, 12, 5, 8},    // Goldeen
+            {7, 3, 5, 5}}},     // Squirtle
+          // Rocky clearing
+          {12, 11, 16, 19,
+           {{74, 35, 6, 9},     // Geodude
+            {41, 25, 6, 8},     // Zubat
+            {27, 20, 6, 9},     // Sandshrew
+            {23, 12, 6, 8},     // Ekans
+            {56, 6, 7, 9},      // Mankey
+            {4, 2, 5, 5}}},     // Charmander
+      },
+      0.5,
+      60,
+      120,
+      // Trees along the edges, ledges across the middle
+      "#######....###############"
+      "#######....###############"
+      "#######....###############"
+      "#######....###############"
+      "#######....###############"
+      "#######....###############"
+      "#######........###########"
+      "#######........#######...."
+      "#........................."
+      "#........................."
+      "#.....................#.##"
+      "#..................####.##"
+      "##########.........####.##"
+      "##.................####.##"
+      "##.................####.##"
+      "##.................####.##"
+      "##.....####............###"
+      "##.....#................##"
+      "##.....#................##"
+      "##.....#.................#"
+      "##.....#.................#"
+      "##.....#.................#"
+      "##.....#.................."
+      "##.....#.....#############"
+      "##.....#.....#############"
+      "##.....#.....#############",
+      9,
+      0};
+}
@@ -0,0 +1,107 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the admission controller
+
+#include "utils/admission_control.hpp"
+#include <algorithm>
+#include <string>
+
+namespace {
+
+Counter rejected_counter(const char* priority) {
+  return MetricsRegistry::instance().counter(
+      "admission_rejected_total",
+      "Requests refused with 503 because the database is overloaded",
+      std::string("priority=\"") + priority + "\"");
+}
+
+}  // namespace
+
+AdmissionController::AdmissionController(const WorkerPool& pool,
+                                         AdmissionThresholds thresholds,
+                                         std::chrono::milliseconds window)
+    : pool(pool),
+      thresholds(thresholds),
+      slice(std::max(window, std::chrono::milliseconds(kWindowSlices)) /
+            kWindowSlices),
+      retry_after_seconds(std::max<std::int64_t>(
+          (window.count() + 999) / 1000, 1)),
+      rejected_normal(rejected_counter("normal")),
+      rejected_low(rejected_counter("low")) {}
+
+bool AdmissionController::admit(AdmissionPriority priority) {
+  if (priority == AdmissionPriority::kCritical) return true;
+
+  const Clock::time_point now = Clock::now();
+  if (now.time_since_epoch().count() >=
+      next_refresh.load(std::memory_order_relaxed)) {
+    refresh(now);
+  }
+
+  const OverloadLevel current = level();
+  if (current == OverloadLevel::kNone) return true;
+  if (priority == AdmissionPriority::kLow) {
+    rejected_low.inc();
+    return false;
+  }
+  if (current == OverloadLevel::kSevere) {
+    rejected_normal.inc();
+    return false;
+  }
+  return true;
+}
+
+void AdmissionController::refresh(Clock::time_point now) {
+  std::unique_lock<std::mutex> lock(refresh_mutex, std::try_to_lock);
+  if (!lock.owns_lock()) return;
+  if (now.time_since_epoch().count() <
+      next_refresh.load(std::memory_order_relaxed)) {
+    return;  // Another request refreshed just before this one
+  }
+  next_refresh.store((now + slice).time_since_epoch().count(),
+                     std::memory_order_relaxed);
+
+  // The ring holds the snapshots of the last kWindowSlices refreshes; the
+  // slot about to be overwritten is the start of the window. After an idle
+  // spell those are too old to say anything about recent latency, so the
+  // window starts over.
+  const HistogramSnapshot latest = pool.latency().snapshot();
+  if (now - last_refresh > slice * static_cast<int>(kWindowSlices)) {
+    history.fill(latest);
+  }
+  last_refresh = now;
+  const std::uint64_t p99 = latest.since(history[history_next]).quantile(0.99);
+  history[history_next] = latest;
+  history_next = (history_next + 1) % history.size();
+
+  const std::size_t depth = pool.stats().queue_depth;
+
+  // Load relative to the most exceeded threshold: 1 means it is just reached
+  double load = 0;
+  if (thresholds.queue_depth > 0) {
+    load = std::max(load, static_cast<double>(depth) /
+                              static_cast<double>(thresholds.queue_depth));
+  }
+  if (thresholds.p99.count() > 0) {
+    const auto limit_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(thresholds.p99);
+    load = std::max(load, static_cast<double>(p99) /
+                              static_cast<double>(limit_ns.count()));
+  }
+
+  OverloadLevel next = OverloadLevel::kNone;
+  if (load >= 2) {
+    next = OverloadLevel::kSevere;
+  } else if (load >= 1) {
+    next = OverloadLevel::kElevated;
+  }
+
+  queue_depth.store(depth, std::memory_order_relaxed);
+  p99_ns.store(p99, std::memory_order_relaxed);
+  overload.store(next, std::memory_order_relaxed);
+}
+
+AdmissionStats AdmissionController::stats() const {
+  return {level(), queue_depth.load(std::memory_order_relaxed),
+          p99_ns.load(std::memory_order_relaxed) / 1000,
+          rejected_normal.value(), rejected_low.value()};
+}
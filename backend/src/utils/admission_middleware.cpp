@@ -0,0 +1,25 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the admission control middleware
+
+#include "utils/admission_middleware.hpp"
+
+#include "models/api_response.hpp"
+
+void AdmissionMiddleware::priority(const std::string& path,
+                                   AdmissionPriority priority) {
+  routes[path] = priority;
+}
+
+void AdmissionMiddleware::before_handle(crow::request& req,
+                                        crow::response& res, context&) {
+  if (!controller) return;
+  auto route = routes.find(req.url);
+  const AdmissionPriority priority =
+      route != routes.end() ? route->second : AdmissionPriority::kNormal;
+  if (controller->admit(priority)) return;
+
+  res = responses::kServerBusy.ToResponse();
+  res.set_header("Retry-After",
+                 std::to_string(controller->retry_after().count()));
+  res.end();
+}
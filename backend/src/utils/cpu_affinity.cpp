@@ -0,0 +1,56 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the CPU affinity helpers
+
+#include "utils/cpu_affinity.hpp"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+std::vector<int> parse_cpu_list(const std::string& list) {
+  std::vector<int> cpus;
+  std::stringstream ranges(list);
+  std::string range;
+  while (std::getline(ranges, range, ',')) {
+    if (range.empty()) continue;
+    try {
+      std::size_t used = 0;
+      const int first = std::stoi(range, &used);
+      int last = first;
+      if (used < range.size()) {
+        if (range[used] != '-') throw std::invalid_argument(range);
+        std::size_t used_last = 0;
+        last = std::stoi(range.substr(used + 1), &used_last);
+        if (used + 1 + used_last != range.size()) {
+          throw std::invalid_argument(range);
+        }
+      }
+      if (first < 0 || last < first) throw std::invalid_argument(range);
+      for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+    } catch (const std::logic_error&) {
+      throw std::invalid_argument("Invalid CPU list: " + list);
+    }
+  }
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return cpus;
+}
+
+bool set_thread_affinity(const std::vector<int>& cpus) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    if (cpu >= CPU_SETSIZE) return false;
+    CPU_SET(cpu, &set);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  (void)cpus;
+  return false;
+#endif
+}
@@ -0,0 +1,28 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the drain middleware
+
+#include "utils/drain_middleware.hpp"
+
+void DrainMiddleware::before_handle(crow::request& req, crow::response&,
+                                    context& ctx) {
+  // Upgraded connections never complete a response, so their after_handle
+  // is not called; they are closed by the server instead
+  if (req.upgrade) return;
+  requests.fetch_add(1, std::memory_order_relaxed);
+  ctx.counted = true;
+}
+
+void DrainMiddleware::after_handle(crow::request&, crow::response& res,
+                                   context& ctx) {
+  if (draining.load(std::memory_order_relaxed)) {
+    res.set_header("Connection", "close");
+  }
+
+  // Crow calls after_handle without before_handle for requests that match
+  // no route, and the context can outlive a request on the same
+  // connection, so only undo what before_handle did
+  if (ctx.counted) {
+    requests.fetch_sub(1, std::memory_order_relaxed);
+    ctx.counted = false;
+  }
+}
@@ -0,0 +1,115 @@
+#include "utils/env.hpp"
+#include "utils/logger.hpp"
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <system_error>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+const char* const kEnvFile = "../.env"; // Locates the .env file that will be read
+
+std::atomic<const EnvSnapshot*> current{nullptr};
+
+// Serializes writers and owns every snapshot ever published
+std::mutex& publishMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::vector<std::unique_ptr<const EnvSnapshot>>& publishedSnapshots() {
+    static std::vector<std::unique_ptr<const EnvSnapshot>> snapshots;
+    return snapshots;
+}
+
+const EnvSnapshot* publish(std::unordered_map<std::string, std::string> values) {
+    auto& snapshots = publishedSnapshots();
+    const std::uint64_t version = snapshots.size() + 1;
+    snapshots.push_back(std::make_unique<const EnvSnapshot>(std::move(values), version));
+    const EnvSnapshot* snapshot = snapshots.back().get();
+    current.store(snapshot, std::memory_order_release);
+    return snapshot;
+}
+
+}  // namespace
+
+std::unordered_map<std::string, std::string> EnvLoader::parseFile() {
+    std::unordered_map<std::string, std::string> values;
+    std::ifstream file(kEnvFile);
+    std::string line;
+
+    while (std::getline(file, line)) {
+        // Ignores empty lines or comments
+        if (line.empty() || line[0] == '#') continue;
+
+        // Searchs for equal sign
+        auto pos = line.find('=');
+        if (pos == std::string::npos) continue;
+
+        // Extracts the key and Value; the first definition of a key wins
+        values.emplace(line.substr(0, pos), line.substr(pos + 1));
+    }
+
+    return values;
+}
+
+const EnvSnapshot& EnvLoader::snapshot() {
+    const EnvSnapshot* snapshot = current.load(std::memory_order_acquire);
+    if (snapshot) return *snapshot;
+
+    // First use: parse the file exactly once even if several threads race here
+    std::lock_guard<std::mutex> lock(publishMutex());
+    snapshot = current.load(std::memory_order_acquire);
+    return snapshot ? *snapshot : *publish(parseFile());
+}
+
+bool EnvLoader::reload() {
+    auto values = parseFile();
+    std::lock_guard<std::mutex> lock(publishMutex());
+
+    const EnvSnapshot* previous = current.load(std::memory_order_acquire);
+    if (previous && previous->sameValues(values)) return false;
+
+    publish(std::move(values));
+    return true;
+}
+
+EnvWatcher::EnvWatcher(std::chrono::milliseconds interval)
+    : thread([this, interval] { run(interval); }) {}
+
+EnvWatcher::~EnvWatcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    stopRequested.notify_one();
+    thread.join();
+}
+
+void EnvWatcher::run(std::chrono::milliseconds interval) {
+    // Modification time and size of the file as last seen; a missing file
+    // is remembered as an error so that creating it triggers a reload
+    auto fileState = [] {
+        std::error_code error;
+        auto modified = std::filesystem::last_write_time(kEnvFile, error);
+        auto size = error ? 0 : std::filesystem::file_size(kEnvFile, error);
+        return std::make_tuple(modified, size, static_cast<bool>(error));
+    };
+
+    auto lastSeen = fileState();
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopRequested.wait_for(lock, interval, [this] { return stopping; })) {
+        auto state = fileState();
+        if (state == lastSeen) continue;
+        lastSeen = state;
+
+        lock.unlock();
+        if (EnvLoader::reload()) {
+            LOG_INFO << "Reloaded " << kEnvFile << " (version "
+                     << EnvLoader::snapshot().getVersion() << ")";
+        }
+        lock.lock();
+    }
+}
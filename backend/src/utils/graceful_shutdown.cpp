@@ -0,0 +1,95 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the graceful shutdown coordinator
+
+#include "utils/graceful_shutdown.hpp"
+#include <csignal>
+#include <utility>
+
+#include "utils/logger.hpp"
+
+GracefulShutdown::GracefulShutdown(DrainMiddleware& requests,
+                                   std::chrono::milliseconds timeout,
+                                   std::function<void()> stop_accepting,
+                                   std::function<void()> stop)
+    : requests(requests),
+      timeout(timeout),
+      stop_accepting(std::move(stop_accepting)),
+      stop(std::move(stop)),
+      signals(io, SIGINT, SIGTERM),
+      poll(io) {
+  wait_for_signal();
+  watcher = std::thread([this] { io.run(); });
+}
+
+GracefulShutdown::~GracefulShutdown() {
+  io.stop();
+  if (watcher.joinable()) watcher.join();
+}
+
+GracefulShutdown::Clock::time_point GracefulShutdown::deadline() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return drain_deadline;
+}
+
+void GracefulShutdown::wait_for_signal() {
+  signals.async_wait([this](const asio::error_code& error, int signal) {
+    if (error) return;
+    if (!draining) {
+      begin_drain(signal);
+      wait_for_signal();
+      return;
+    }
+    LOG_WARNING << "Second signal received, stopping with "
+                << requests.in_flight() << " requests in flight";
+    finish();
+  });
+}
+
+void GracefulShutdown::begin_drain(int signal) {
+  draining = true;
+  drain_started = Clock::now();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    drain_deadline = drain_started + timeout;
+  }
+  LOG_INFO << "Signal " << signal << " received, draining "
+           << requests.in_flight() << " requests in flight (deadline "
+           << timeout.count() << " ms)";
+
+  requests.start_draining();
+  stop_accepting();
+
+  poll.expires_after(kPollInterval);
+  poll.async_wait([this](const asio::error_code& error) {
+    if (!error) check_drained();
+  });
+}
+
+void GracefulShutdown::check_drained() {
+  if (stopped) return;
+  const std::size_t in_flight = requests.in_flight();
+  const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      Clock::now() - drain_started);
+  if (in_flight == 0) {
+    LOG_INFO << "Drained in " << elapsed.count() << " ms";
+    finish();
+    return;
+  }
+  if (elapsed >= timeout) {
+    LOG_WARNING << "Drain deadline passed with " << in_flight
+                << " requests in flight";
+    finish();
+    return;
+  }
+  poll.expires_after(kPollInterval);
+  poll.async_wait([this](const asio::error_code& error) {
+    if (!error) check_drained();
+  });
+}
+
+void GracefulShutdown::finish() {
+  if (stopped) return;
+  stopped = true;
+  poll.cancel();
+  stop();
+}
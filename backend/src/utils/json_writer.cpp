@@ -0,0 +1,147 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the streaming JSON writer
+
+#include "utils/json_writer.hpp"
+#include <charconv>
+#include <cmath>
+
+namespace {
+
+constexpr char kHex[] = "0123456789abcdef";
+
+// Characters that cannot appear unescaped inside a JSON string
+bool needs_escape(char c) {
+  return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+}
+
+}  // namespace
+
+JsonWriter JsonWriter::local() {
+  // Starts at a size that fits every current response, so the first
+  // requests on a thread do not grow it step by step
+  thread_local std::string buffer = [] {
+    std::string initial;
+    initial.reserve(1024);
+    return initial;
+  }();
+  buffer.clear();
+  return JsonWriter(buffer);
+}
+
+void JsonWriter::separate() {
+  if (after_key) {
+    after_key = false;
+    return;
+  }
+  if (depth == 0 || depth > kMaxDepth) return;
+  const std::uint64_t bit = std::uint64_t{1} << (depth - 1);
+  if (has_items & bit) out += ',';
+  has_items |= bit;
+}
+
+JsonWriter& JsonWriter::open(char bracket) {
+  separate();
+  out += bracket;
+  ++depth;
+  if (depth <= kMaxDepth) has_items &= ~(std::uint64_t{1} << (depth - 1));
+  return *this;
+}
+
+JsonWriter& JsonWriter::close(char bracket) {
+  out += bracket;
+  --depth;
+  return *this;
+}
+
+JsonWriter& JsonWriter::begin_object() { return open('{'); }
+JsonWriter& JsonWriter::end_object() { return close('}'); }
+JsonWriter& JsonWriter::begin_array() { return open('['); }
+JsonWriter& JsonWriter::end_array() { return close(']'); }
+
+JsonWriter& JsonWriter::key(std::string_view name) {
+  separate();
+  write_string(name);
+  out += ':';
+  after_key = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view text) {
+  separate();
+  write_string(text);
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(bool flag) {
+  separate();
+  out += flag ? "true" : "false";
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(double number) {
+  separate();
+  if (!std::isfinite(number)) {
+    out += "null";
+    return *this;
+  }
+  char buffer[32];
+  const auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+  out.append(buffer, result.ptr);
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(std::nullptr_t) {
+  separate();
+  out += "null";
+  return *this;
+}
+
+JsonWriter& JsonWriter::raw(std::string_view json) {
+  separate();
+  out += json;
+  return *this;
+}
+
+JsonWriter& JsonWriter::write_integer(std::int64_t number) {
+  separate();
+  char buffer[24];
+  const auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+  out.append(buffer, result.ptr);
+  return *this;
+}
+
+JsonWriter& JsonWriter::write_integer(std::uint64_t number) {
+  separate();
+  char buffer[24];
+  const auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+  out.append(buffer, result.ptr);
+  return *this;
+}
+
+void JsonWriter::write_string(std::string_view text) {
+  out += '"';
+  // Copy runs of plain characters in one go; most strings have no escapes
+  std::size_t run_start = 0;
+  for (std::size_t i = 0; i < text.size(); ++i) {
+    const char c = text[i];
+    if (!needs_escape(c)) continue;
+    out.append(text.data() + run_start, i - run_start);
+    run_start = i + 1;
+    switch (c) {
+      case '"': out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n"; break;
+      case '\r': out += "\\r"; break;
+      case '\t': out += "\\t"; break;
+      case '\b': out += "\\b"; break;
+      case '\f': out += "\\f"; break;
+      default: {
+        const char escaped[] = {'\\', 'u', '0', '0', kHex[(c >> 4) & 0xf],
+                                kHex[c & 0xf]};
+        out.append(escaped, sizeof(escaped));
+      }
+    }
+  }
+  out.append(text.data() + run_start, text.size() - run_start);
+  out += '"';
+}
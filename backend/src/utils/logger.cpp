@@ -0,0 +1,238 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the asynchronous logger
+
+#include "utils/logger.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+
+#include "crow/logging.h"
+
+namespace {
+
+// How often the flusher drains the rings when nothing wakes it earlier
+constexpr std::chrono::milliseconds kFlushInterval(10);
+
+std::int64_t now_us() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+const char* level_name(LogLevel level) {
+  switch (level) {
+    case LogLevel::kDebug:
+      return "DEBUG  ";
+    case LogLevel::kInfo:
+      return "INFO   ";
+    case LogLevel::kWarning:
+      return "WARNING";
+    case LogLevel::kError:
+      return "ERROR  ";
+  }
+  return "INFO   ";
+}
+
+// Appends "(2024-05-01 12:00:00.123) [INFO   ] #3 message\n"
+void format_record(const LogRecord& record, std::string& out) {
+  std::time_t seconds = record.timestamp_us / 1000000;
+  std::tm utc{};
+  gmtime_r(&seconds, &utc);
+
+  char prefix[64];
+  int written = std::snprintf(
+      prefix, sizeof(prefix), "(%04d-%02d-%02d %02d:%02d:%02d.%03d) [%s] #%u ",
+      utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday, utc.tm_hour, utc.tm_min,
+      utc.tm_sec, static_cast<int>(record.timestamp_us / 1000 % 1000),
+      level_name(record.level), record.thread);
+  out.append(prefix, std::min<std::size_t>(written, sizeof(prefix) - 1));
+  out.append(record.text, record.length);
+  out.push_back('\n');
+}
+
+// Marks a thread's ring as closed when the thread exits so the flusher
+// can free it after writing what is left.
+struct RingOwner {
+  std::shared_ptr<LogRing> ring;
+  ~RingOwner() {
+    if (ring) ring->closed.store(true, std::memory_order_release);
+  }
+};
+
+thread_local RingOwner this_thread_ring;
+
+// Forwards Crow's CROW_LOG_* output to the Logger
+class CrowLogHandler : public crow::ILogHandler {
+ public:
+  void log(std::string message, crow::LogLevel level) override {
+    switch (level) {
+      case crow::LogLevel::Debug:
+        LOG_DEBUG << "crow: " << message;
+        break;
+      case crow::LogLevel::Info:
+        LOG_INFO << "crow: " << message;
+        break;
+      case crow::LogLevel::Warning:
+        LOG_WARNING << "crow: " << message;
+        break;
+      default:
+        LOG_ERROR << "crow: " << message;
+        break;
+    }
+  }
+};
+
+}  // namespace
+
+bool LogRing::push(LogLevel level, std::int64_t timestamp_us,
+                   std::string_view text) {
+  const std::size_t write = tail.load(std::memory_order_relaxed);
+  if (write - head.load(std::memory_order_acquire) == kLogRingCapacity) {
+    dropped_count.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  LogRecord& record = slots[write % kLogRingCapacity];
+  record.timestamp_us = timestamp_us;
+  record.thread = thread;
+  record.level = level;
+  record.length = static_cast<std::uint16_t>(
+      std::min(text.size(), kLogMessageCapacity));
+  std::memcpy(record.text, text.data(), record.length);
+
+  tail.store(write + 1, std::memory_order_release);
+  return true;
+}
+
+void LogRing::drain(std::vector<LogRecord>& out) {
+  std::size_t read = head.load(std::memory_order_relaxed);
+  const std::size_t end = tail.load(std::memory_order_acquire);
+  for (; read != end; ++read) {
+    out.push_back(slots[read % kLogRingCapacity]);
+  }
+  head.store(read, std::memory_order_release);
+}
+
+Logger& Logger::instance() {
+  static Logger logger;
+  return logger;
+}
+
+Logger::Logger() : flusher([this] { flush_loop(); }) {}
+
+Logger::~Logger() {
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex);
+    stopping = true;
+  }
+  wake.notify_one();
+  flusher.join();
+  drain();
+}
+
+LogLevel Logger::parse_level(const std::string& name) {
+  if (name == "debug") return LogLevel::kDebug;
+  if (name == "warning") return LogLevel::kWarning;
+  if (name == "error") return LogLevel::kError;
+  return LogLevel::kInfo;
+}
+
+LogRing& Logger::ring_for_this_thread() {
+  if (!this_thread_ring.ring) {
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    this_thread_ring.ring = std::make_shared<LogRing>(next_thread++);
+    rings.push_back(this_thread_ring.ring);
+  }
+  return *this_thread_ring.ring;
+}
+
+void Logger::submit(LogLevel level, std::string_view text) {
+  ring_for_this_thread().push(level, now_us(), text);
+
+  // Errors are written right away instead of waiting for the next tick
+  if (level == LogLevel::kError) wake.notify_one();
+}
+
+void Logger::flush() { drain(); }
+
+LoggerStats Logger::stats() const {
+  std::lock_guard<std::mutex> lock(rings_mutex);
+  std::uint64_t dropped = dropped_retired;
+  for (const auto& ring : rings) dropped += ring->dropped();
+  return {written.load(std::memory_order_relaxed), dropped, rings.size()};
+}
+
+void Logger::flush_loop() {
+  std::unique_lock<std::mutex> lock(wake_mutex);
+  while (!stopping) {
+    wake.wait_for(lock, kFlushInterval);
+    lock.unlock();
+    drain();
+    lock.lock();
+  }
+}
+
+void Logger::drain() {
+  std::lock_guard<std::mutex> drain_lock(drain_mutex);
+
+  std::uint64_t dropped = 0;
+  {
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    for (const auto& ring : rings) ring->drain(pending);
+
+    // Free the rings of exited threads once nothing is left in them
+    std::erase_if(rings, [this](const std::shared_ptr<LogRing>& ring) {
+      if (!ring->closed.load(std::memory_order_acquire) || !ring->empty()) {
+        return false;
+      }
+      dropped_retired += ring->dropped();
+      return true;
+    });
+
+    // Counted after retiring, so a freed ring's drops are not added twice
+    dropped = dropped_retired;
+    for (const auto& ring : rings) dropped += ring->dropped();
+  }
+
+  if (pending.empty() && dropped == dropped_reported) return;
+
+  // Rings are drained one after another; restore the global order
+  std::stable_sort(pending.begin(), pending.end(),
+                   [](const LogRecord& a, const LogRecord& b) {
+                     return a.timestamp_us < b.timestamp_us;
+                   });
+
+  for (const LogRecord& record : pending) {
+    format_record(record,
+                  record.level >= LogLevel::kWarning ? err_buffer : out_buffer);
+  }
+  if (dropped > dropped_reported) {
+    char note[96];
+    int length = std::snprintf(
+        note, sizeof(note), "[WARNING] Logger dropped %llu records (ring full)\n",
+        static_cast<unsigned long long>(dropped - dropped_reported));
+    err_buffer.append(note, std::min<std::size_t>(length, sizeof(note) - 1));
+    dropped_reported = dropped;
+  }
+
+  if (!out_buffer.empty()) {
+    std::fwrite(out_buffer.data(), 1, out_buffer.size(), stdout);
+    std::fflush(stdout);
+  }
+  if (!err_buffer.empty()) {
+    std::fwrite(err_buffer.data(), 1, err_buffer.size(), stderr);
+    std::fflush(stderr);
+  }
+
+  written.fetch_add(pending.size(), std::memory_order_relaxed);
+  pending.clear();
+  out_buffer.clear();
+  err_buffer.clear();
+}
+
+void route_crow_logs() {
+  static CrowLogHandler handler;
+  crow::logger::setHandler(&handler);
+}
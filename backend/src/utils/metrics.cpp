@@ -0,0 +1,280 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the metrics registry
+
+#include "utils/metrics.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <stdexcept>
+
+namespace {
+
+// Upper bounds (seconds) of the buckets exported to Prometheus. The HDR
+// buckets are much finer; each exported bucket sums the HDR buckets that
+// end at or below its bound.
+constexpr double kExportBounds[] = {
+    0.00001, 0.000025, 0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025,
+    0.005,   0.01,     0.025,   0.05,   0.1,     0.25,   0.5,   1,
+    2.5,     5,        10,      30};
+
+void append_number(std::string& out, double value) {
+  char buffer[32];
+  const int length = std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+  out.append(buffer, length);
+}
+
+// name{labels,extra} with empty parts left out
+void append_series(std::string& out, const std::string& name,
+                   const char* suffix, const std::string& labels,
+                   const std::string& extra) {
+  out += name;
+  out += suffix;
+  if (labels.empty() && extra.empty()) return;
+  out += '{';
+  out += labels;
+  if (!labels.empty() && !extra.empty()) out += ',';
+  out += extra;
+  out += '}';
+}
+
+// Increments a cell that only the calling thread writes
+inline void bump(std::atomic<std::uint64_t>& cell, std::uint64_t n) {
+  cell.store(cell.load(std::memory_order_relaxed) + n,
+             std::memory_order_relaxed);
+}
+
+}  // namespace
+
+std::size_t HistogramSnapshot::bucket_of(std::uint64_t ns) {
+  if (ns < kHistogramSubBuckets) return ns;
+  const int exponent = std::bit_width(ns) - 1;
+  if (exponent > kHistogramMaxExponent) return kHistogramBuckets - 1;
+  const int shift = exponent - kHistogramSubBucketBits;
+  const std::size_t sub = (ns >> shift) & (kHistogramSubBuckets - 1);
+  return (shift + 1) * kHistogramSubBuckets + sub;
+}
+
+std::uint64_t HistogramSnapshot::upper_bound(std::size_t bucket) {
+  if (bucket < kHistogramSubBuckets) return bucket;
+  const int shift = static_cast<int>(bucket / kHistogramSubBuckets) - 1;
+  const std::uint64_t sub = bucket % kHistogramSubBuckets;
+  const std::uint64_t lower = (kHistogramSubBuckets + sub) << shift;
+  return lower + (std::uint64_t{1} << shift) - 1;
+}
+
+std::uint64_t HistogramSnapshot::quantile(double q) const {
+  if (count == 0) return 0;
+  const auto rank = static_cast<std::uint64_t>(q * (count - 1)) + 1;
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < kHistogramBuckets; ++i) {
+    seen += counts[i];
+    if (seen >= rank) return upper_bound(i);
+  }
+  return upper_bound(kHistogramBuckets - 1);
+}
+
+HistogramSnapshot HistogramSnapshot::since(
+    const HistogramSnapshot& earlier) const {
+  // Cells are summed one by one while threads keep recording, so count is
+  // recomputed from the buckets to stay consistent with them
+  HistogramSnapshot delta;
+  for (std::size_t i = 0; i < kHistogramBuckets; ++i) {
+    delta.counts[i] =
+        counts[i] > earlier.counts[i] ? counts[i] - earlier.counts[i] : 0;
+    delta.count += delta.counts[i];
+  }
+  delta.sum_ns = sum_ns > earlier.sum_ns ? sum_ns - earlier.sum_ns : 0;
+  return delta;
+}
+
+MetricsRegistry& MetricsRegistry::instance() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+MetricsRegistry::Slab& MetricsRegistry::local_slab() {
+  // Owns the calling thread's slab and folds it into the retired totals
+  // when the thread exits
+  struct Owner {
+    Slab* slab = nullptr;
+    ~Owner() {
+      if (slab) instance().retire(slab);
+    }
+  };
+  thread_local Owner owner;
+
+  if (!owner.slab) {
+    auto* slab = new Slab();
+    MetricsRegistry& registry = instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.slabs.push_back(slab);
+    owner.slab = slab;
+  }
+  return *owner.slab;
+}
+
+void MetricsRegistry::retire(Slab* slab) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (std::size_t i = 0; i < kMaxCells; ++i) {
+      bump(retired.cells[i], slab->cells[i].load(std::memory_order_relaxed));
+    }
+    std::erase(slabs, slab);
+  }
+  delete slab;
+}
+
+std::uint64_t MetricsRegistry::sum_locked(std::size_t cell) const {
+  std::uint64_t total = retired.cells[cell].load(std::memory_order_relaxed);
+  for (const Slab* slab : slabs) {
+    total += slab->cells[cell].load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+const MetricsRegistry::Metric& MetricsRegistry::add(
+    Kind kind, const std::string& name, const std::string& help,
+    const std::string& labels, std::size_t cells,
+    std::function<double()> sample) {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const auto& metric : metrics) {
+    if (metric->name == name && metric->labels == labels) {
+      if (metric->kind != kind) {
+        throw std::runtime_error("Metric " + name + " registered twice");
+      }
+      return *metric;
+    }
+  }
+
+  if (next_cell + cells > kMaxCells) {
+    throw std::runtime_error("Too many metrics; raise MetricsRegistry::kMaxCells");
+  }
+  metrics.push_back(std::make_unique<Metric>(
+      Metric{kind, name, help, labels, next_cell, std::move(sample)}));
+  next_cell += cells;
+  return *metrics.back();
+}
+
+Counter MetricsRegistry::counter(const std::string& name,
+                                 const std::string& help,
+                                 const std::string& labels) {
+  return Counter(add(Kind::kCounter, name, help, labels, 1, nullptr).cell);
+}
+
+Histogram MetricsRegistry::histogram(const std::string& name,
+                                     const std::string& help,
+                                     const std::string& labels) {
+  return Histogram(add(Kind::kHistogram, name, help, labels,
+                       kHistogramBuckets + 2, nullptr)
+                       .cell);
+}
+
+void MetricsRegistry::gauge(const std::string& name, const std::string& help,
+                            const std::string& labels,
+                            std::function<double()> sample) {
+  add(Kind::kGauge, name, help, labels, 0, std::move(sample));
+}
+
+void Counter::inc(std::uint64_t n) const {
+  bump(MetricsRegistry::local_slab().cells[cell], n);
+}
+
+std::uint64_t Counter::value() const {
+  MetricsRegistry& registry = MetricsRegistry::instance();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  return registry.sum_locked(cell);
+}
+
+void Histogram::record(std::uint64_t ns) const {
+  auto& cells = MetricsRegistry::local_slab().cells;
+  bump(cells[first_cell + HistogramSnapshot::bucket_of(ns)], 1);
+  bump(cells[first_cell + kHistogramBuckets], 1);
+  bump(cells[first_cell + kHistogramBuckets + 1], ns);
+}
+
+HistogramSnapshot Histogram::snapshot() const {
+  MetricsRegistry& registry = MetricsRegistry::instance();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+
+  HistogramSnapshot result;
+  for (std::size_t i = 0; i < kHistogramBuckets; ++i) {
+    result.counts[i] = registry.sum_locked(first_cell + i);
+  }
+  result.count = registry.sum_locked(first_cell + kHistogramBuckets);
+  result.sum_ns = registry.sum_locked(first_cell + kHistogramBuckets + 1);
+  return result;
+}
+
+std::string MetricsRegistry::render() const {
+  // Snapshot the gauges without holding the lock; their callbacks may take
+  // other locks (worker pools, connection pool)
+  std::vector<const Metric*> all;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& metric : metrics) all.push_back(metric.get());
+  }
+  // Keep each family together even if its series were registered apart
+  std::stable_sort(all.begin(), all.end(), [](const Metric* a, const Metric* b) {
+    return a->name < b->name;
+  });
+
+  std::string out;
+  out.reserve(16384);
+  const std::string* last_name = nullptr;
+
+  for (const Metric* metric : all) {
+    // HELP and TYPE once per metric family
+    if (!last_name || *last_name != metric->name) {
+      static constexpr const char* kTypes[] = {"counter", "histogram", "gauge"};
+      out += "# HELP " + metric->name + " " + metric->help + "\n";
+      out += "# TYPE " + metric->name + " " +
+             kTypes[static_cast<int>(metric->kind)] + "\n";
+      last_name = &metric->name;
+    }
+
+    switch (metric->kind) {
+      case Kind::kCounter: {
+        append_series(out, metric->name, "", metric->labels, "");
+        out += ' ';
+        out += std::to_string(Counter(metric->cell).value());
+        out += '\n';
+        break;
+      }
+      case Kind::kGauge: {
+        append_series(out, metric->name, "", metric->labels, "");
+        out += ' ';
+        append_number(out, metric->sample());
+        out += '\n';
+        break;
+      }
+      case Kind::kHistogram: {
+        const HistogramSnapshot snapshot = Histogram(metric->cell).snapshot();
+        std::size_t bucket = 0;
+        std::uint64_t cumulative = 0;
+        for (double bound : kExportBounds) {
+          const auto bound_ns = static_cast<std::uint64_t>(bound * 1e9);
+          while (bucket < kHistogramBuckets &&
+                 HistogramSnapshot::upper_bound(bucket) <= bound_ns) {
+            cumulative += snapshot.counts[bucket++];
+          }
+          std::string le = "le=\"";
+          append_number(le, bound);
+          le += '"';
+          append_series(out, metric->name, "_bucket", metric->labels, le);
+          out += ' ' + std::to_string(cumulative) + '\n';
+        }
+        append_series(out, metric->name, "_bucket", metric->labels,
+                      "le=\"+Inf\"");
+        out += ' ' + std::to_string(snapshot.count) + '\n';
+        append_series(out, metric->name, "_sum", metric->labels, "");
+        out += ' ';
+        append_number(out, snapshot.sum_ns / 1e9);
+        out += '\n';
+        append_series(out, metric->name, "_count", metric->labels, "");
+        out += ' ' + std::to_string(snapshot.count) + '\n';
+        break;
+      }
+    }
+  }
+  return out;
+}
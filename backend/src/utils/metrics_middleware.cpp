@@ -0,0 +1,93 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the request metrics middleware
+
+#include "utils/metrics_middleware.hpp"
+
+MetricsMiddleware::MetricsMiddleware() : other(make_route("other")) {}
+
+MetricsMiddleware::RouteMetrics MetricsMiddleware::make_route(
+    const std::string& path) {
+  MetricsRegistry& registry = MetricsRegistry::instance();
+  const std::string route = "route=\"" + path + "\"";
+
+  auto responses = [&](const char* code) {
+    return registry.counter("http_responses_total",
+                            "HTTP responses by route and status class",
+                            route + ",code=\"" + code + "\"");
+  };
+
+  return RouteMetrics{
+      registry.histogram("http_request_duration_seconds",
+                         "Time from request to completed response", route),
+      {responses("1xx"), responses("2xx"), responses("3xx"), responses("4xx"),
+       responses("5xx")}};
+}
+
+void MetricsMiddleware::add_route(const std::string& path) {
+  if (path.find('<') == std::string::npos) {
+    routes.emplace(path, make_route(path));
+  } else {
+    patterns.emplace_back(path, make_route(path));
+  }
+}
+
+bool MetricsMiddleware::matches(std::string_view pattern,
+                                std::string_view url) {
+  constexpr std::string_view kUint = "<uint>";
+  while (!pattern.empty()) {
+    if (pattern.starts_with(kUint)) {
+      std::size_t digits = 0;
+      while (digits < url.size() && url[digits] >= '0' && url[digits] <= '9') {
+        ++digits;
+      }
+      if (digits == 0) return false;
+      pattern.remove_prefix(kUint.size());
+      url.remove_prefix(digits);
+      continue;
+    }
+    if (url.empty() || pattern.front() != url.front()) return false;
+    pattern.remove_prefix(1);
+    url.remove_prefix(1);
+  }
+  return url.empty();
+}
+
+const MetricsMiddleware::RouteMetrics& MetricsMiddleware::route_of(
+    const std::string& url) const {
+  auto it = routes.find(url);
+  if (it != routes.end()) return it->second;
+  for (const auto& [pattern, metrics] : patterns) {
+    if (matches(pattern, url)) return metrics;
+  }
+  return other;
+}
+
+void MetricsMiddleware::before_handle(crow::request&, crow::response&,
+                                      context& ctx) {
+  ctx.start = std::chrono::steady_clock::now();
+}
+
+void MetricsMiddleware::after_handle(crow::request& req, crow::response& res,
+                                     context& ctx) {
+  record(route_of(req.url), res.code, ctx);
+}
+
+void MetricsMiddleware::record_upgrade(const crow::request& req, context& ctx,
+                                       int code) const {
+  record(route_of(req.url), code, ctx);
+}
+
+void MetricsMiddleware::record(const RouteMetrics& metrics, int code,
+                               context& ctx) const {
+  // Crow answers requests that match no route (404, 405) without calling
+  // before_handle, so there is no start time to measure from. Clearing it
+  // also keeps the next request on this connection from reusing it.
+  if (ctx.start != std::chrono::steady_clock::time_point{}) {
+    metrics.latency.record(std::chrono::steady_clock::now() - ctx.start);
+    ctx.start = {};
+  }
+  const int code_class = code / 100;
+  if (code_class >= 1 && code_class <= 5) {
+    metrics.responses[code_class - 1].inc();
+  }
+}
@@ -0,0 +1,116 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the PBKDF2 password hasher
+
+#include "utils/password_hasher.hpp"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+constexpr std::size_t kSaltBytes = 16;
+constexpr std::size_t kKeyBytes = 32;
+
+std::string to_hex(const unsigned char* data, std::size_t size) {
+  static constexpr char kDigits[] = "0123456789abcdef";
+  std::string hex(size * 2, '0');
+  for (std::size_t i = 0; i < size; ++i) {
+    hex[2 * i] = kDigits[data[i] >> 4];
+    hex[2 * i + 1] = kDigits[data[i] & 0x0f];
+  }
+  return hex;
+}
+
+// Decodes exactly out.size() bytes; returns false on malformed input
+template <std::size_t N>
+bool from_hex(std::string_view hex, std::array<unsigned char, N>& out) {
+  if (hex.size() != 2 * N) return false;
+  for (std::size_t i = 0; i < N; ++i) {
+    auto result = std::from_chars(hex.data() + 2 * i, hex.data() + 2 * i + 2,
+                                  out[i], 16);
+    if (result.ec != std::errc() || result.ptr != hex.data() + 2 * i + 2) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void derive(const std::string& password, const unsigned char* salt,
+            int iterations, unsigned char* key) {
+  if (PKCS5_PBKDF2_HMAC(password.data(), static_cast<int>(password.size()),
+                        salt, kSaltBytes, iterations, EVP_sha256(),
+                        kKeyBytes, key) != 1) {
+    throw std::runtime_error("Password hashing failed");
+  }
+}
+
+}  // namespace
+
+PasswordHasher::PasswordHasher(int iterations)
+    : cost(std::max(iterations, 1)), decoy([this] {
+        std::array<unsigned char, kSaltBytes> random;
+        if (RAND_bytes(random.data(), random.size()) != 1) {
+          throw std::runtime_error("Could not generate a random password");
+        }
+        return hash(to_hex(random.data(), random.size()));
+      }()) {}
+
+std::string PasswordHasher::hash(const std::string& password) const {
+  std::array<unsigned char, kSaltBytes> salt;
+  if (RAND_bytes(salt.data(), salt.size()) != 1) {
+    throw std::runtime_error("Could not generate a password salt");
+  }
+
+  std::array<unsigned char, kKeyBytes> key;
+  derive(password, salt.data(), cost, key.data());
+
+  return std::string(kPasswordHashScheme) + "$" + std::to_string(cost) + "$" +
+         to_hex(salt.data(), salt.size()) + "$" +
+         to_hex(key.data(), key.size());
+}
+
+bool PasswordHasher::verify(const std::string& password,
+                            const std::string& stored) const {
+  const std::string prefix = std::string(kPasswordHashScheme) + "$";
+  if (stored.compare(0, prefix.size(), prefix) != 0) {
+    // Legacy row holding the plain password
+    return password.size() == stored.size() &&
+           CRYPTO_memcmp(password.data(), stored.data(), stored.size()) == 0;
+  }
+  std::string_view rest = std::string_view(stored).substr(prefix.size());
+
+  // <iterations>$<salt>$<key>
+  const auto first = rest.find('$');
+  const auto second = rest.find('$', first + 1);
+  if (first == std::string_view::npos || second == std::string_view::npos) {
+    return false;
+  }
+
+  int iterations = 0;
+  auto parsed = std::from_chars(rest.data(), rest.data() + first, iterations);
+  if (parsed.ec != std::errc() || parsed.ptr != rest.data() + first ||
+      iterations < 1) {
+    return false;
+  }
+
+  std::array<unsigned char, kSaltBytes> salt;
+  std::array<unsigned char, kKeyBytes> expected;
+  if (!from_hex(rest.substr(first + 1, second - first - 1), salt) ||
+      !from_hex(rest.substr(second + 1), expected)) {
+    return false;
+  }
+
+  std::array<unsigned char, kKeyBytes> key;
+  derive(password, salt.data(), iterations, key.data());
+  return CRYPTO_memcmp(key.data(), expected.data(), kKeyBytes) == 0;
+}
+
+bool PasswordHasher::reject(const std::string& password) const {
+  verify(password, decoy);
+  return false;
+}
@@ -0,0 +1,84 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the token bucket table
+
+#include "utils/rate_limiter.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+RateLimiter::RateLimiter(std::size_t capacity)
+    : started(std::chrono::steady_clock::now()),
+      sets_per_shard(std::max<std::size_t>(
+          (capacity + kShards * kWays - 1) / (kShards * kWays), 1)),
+      shards(std::make_unique<Shard[]>(kShards)) {
+  for (std::size_t i = 0; i < kShards; ++i) {
+    shards[i].buckets.resize(sets_per_shard * kWays);
+  }
+}
+
+std::uint32_t RateLimiter::now_ms() const {
+  return static_cast<std::uint32_t>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - started)
+          .count());
+}
+
+std::chrono::milliseconds RateLimiter::acquire(std::string_view key,
+                                               const BucketLimit& limit) {
+  if (!limit.enabled()) return std::chrono::milliseconds(0);
+
+  std::uint64_t hash = std::hash<std::string_view>{}(key);
+  if (hash == 0) hash = 1;
+
+  // Low bits pick the shard, the next bits the set within it
+  Shard& shard = shards[hash % kShards];
+  const std::size_t set = (hash / kShards) % sets_per_shard;
+  const std::uint32_t now = now_ms();
+
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  Bucket* ways = &shard.buckets[set * kWays];
+
+  Bucket* bucket = nullptr;
+  Bucket* victim = &ways[0];
+  for (std::size_t i = 0; i < kWays; ++i) {
+    if (ways[i].key == hash) {
+      bucket = &ways[i];
+      break;
+    }
+    // Prefer a free bucket, then the one idle the longest
+    if (victim->key != 0 &&
+        (ways[i].key == 0 || ways[i].updated_ms < victim->updated_ms)) {
+      victim = &ways[i];
+    }
+  }
+
+  if (bucket) {
+    // Refill for the time since the last call, up to the burst size
+    const double elapsed = (now - bucket->updated_ms) / 1000.0;
+    bucket->tokens = static_cast<float>(
+        std::min(limit.burst, bucket->tokens + elapsed * limit.per_second));
+  } else {
+    if (victim->key != 0) evictions.fetch_add(1, std::memory_order_relaxed);
+    bucket = victim;
+    bucket->key = hash;
+    bucket->tokens = static_cast<float>(limit.burst);
+  }
+  bucket->updated_ms = now;
+
+  if (bucket->tokens >= 1) {
+    bucket->tokens -= 1;
+    allowed.fetch_add(1, std::memory_order_relaxed);
+    return std::chrono::milliseconds(0);
+  }
+
+  limited.fetch_add(1, std::memory_order_relaxed);
+  return std::chrono::milliseconds(static_cast<std::int64_t>(
+      std::ceil((1 - bucket->tokens) / limit.per_second * 1000)));
+}
+
+RateLimiterStats RateLimiter::stats() const {
+  return {kShards * sets_per_shard * kWays,
+          allowed.load(std::memory_order_relaxed),
+          limited.load(std::memory_order_relaxed),
+          evictions.load(std::memory_order_relaxed)};
+}
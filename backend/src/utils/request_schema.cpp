@@ -0,0 +1,248 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the JSON scanner behind request schemas
+
+#include "utils/request_schema.hpp"
+#include <charconv>
+
+namespace {
+
+int hex_digit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+void append_utf8(std::string& out, std::uint32_t code_point) {
+  if (code_point < 0x80) {
+    out += static_cast<char>(code_point);
+  } else if (code_point < 0x800) {
+    out += static_cast<char>(0xc0 | (code_point >> 6));
+    out += static_cast<char>(0x80 | (code_point & 0x3f));
+  } else if (code_point < 0x10000) {
+    out += static_cast<char>(0xe0 | (code_point >> 12));
+    out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+    out += static_cast<char>(0x80 | (code_point & 0x3f));
+  } else {
+    out += static_cast<char>(0xf0 | (code_point >> 18));
+    out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3f));
+    out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+    out += static_cast<char>(0x80 | (code_point & 0x3f));
+  }
+}
+
+}  // namespace
+
+void JsonScanner::skip_whitespace() {
+  while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' ||
+                               text[pos] == '\n' || text[pos] == '\r')) {
+    ++pos;
+  }
+}
+
+bool JsonScanner::consume(char c) {
+  skip_whitespace();
+  if (pos < text.size() && text[pos] == c) {
+    ++pos;
+    return true;
+  }
+  return false;
+}
+
+char JsonScanner::peek() {
+  skip_whitespace();
+  return pos < text.size() ? text[pos] : '\0';
+}
+
+bool JsonScanner::at_end() {
+  skip_whitespace();
+  return pos == text.size();
+}
+
+bool JsonScanner::read_string(std::string_view& out, std::string& decoded) {
+  if (!consume('"')) return false;
+
+  // Fast path: no escapes, so the string is a view into the input
+  const std::size_t start = pos;
+  while (pos < text.size() && text[pos] != '"' && text[pos] != '\\') {
+    if (static_cast<unsigned char>(text[pos]) < 0x20) return false;
+    ++pos;
+  }
+  if (pos == text.size()) return false;
+  if (text[pos] == '"') {
+    out = text.substr(start, pos - start);
+    ++pos;
+    return true;
+  }
+
+  // Escaped: decode into the buffer. Reserving the whole input on the
+  // first escape means appends never reallocate, so views handed out
+  // earlier stay valid.
+  if (decoded.capacity() < text.size()) decoded.reserve(text.size());
+  const std::size_t decoded_start = decoded.size();
+  decoded.append(text.data() + start, pos - start);
+
+  while (pos < text.size() && text[pos] != '"') {
+    const char c = text[pos++];
+    if (static_cast<unsigned char>(c) < 0x20) return false;
+    if (c != '\\') {
+      decoded += c;
+      continue;
+    }
+    if (pos == text.size()) return false;
+    switch (text[pos++]) {
+      case '"': decoded += '"'; break;
+      case '\\': decoded += '\\'; break;
+      case '/': decoded += '/'; break;
+      case 'b': decoded += '\b'; break;
+      case 'f': decoded += '\f'; break;
+      case 'n': decoded += '\n'; break;
+      case 'r': decoded += '\r'; break;
+      case 't': decoded += '\t'; break;
+      case 'u': {
+        auto read_hex4 = [this](std::uint32_t& value) {
+          if (text.size() - pos < 4) return false;
+          value = 0;
+          for (int i = 0; i < 4; ++i) {
+            const int digit = hex_digit(text[pos++]);
+            if (digit < 0) return false;
+            value = value << 4 | static_cast<std::uint32_t>(digit);
+          }
+          return true;
+        };
+        std::uint32_t code_point;
+        if (!read_hex4(code_point)) return false;
+        // A high surrogate must be followed by an escaped low surrogate
+        if (code_point >= 0xd800 && code_point < 0xdc00) {
+          std::uint32_t low;
+          if (text.substr(pos, 2) != "\\u") return false;
+          pos += 2;
+          if (!read_hex4(low) || low < 0xdc00 || low >= 0xe000) return false;
+          code_point = 0x10000 + ((code_point - 0xd800) << 10) + (low - 0xdc00);
+        } else if (code_point >= 0xdc00 && code_point < 0xe000) {
+          return false;
+        }
+        append_utf8(decoded, code_point);
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  if (pos == text.size()) return false;
+  ++pos;  // Closing quote
+  out = std::string_view(decoded).substr(decoded_start);
+  return true;
+}
+
+bool JsonScanner::read_integer(std::int64_t& out) {
+  skip_whitespace();
+  const char* first = text.data() + pos;
+  const char* last = text.data() + text.size();
+  const auto result = std::from_chars(first, last, out);
+  if (result.ec != std::errc()) return false;
+  // Fractions and exponents are not integers
+  if (result.ptr != last &&
+      (*result.ptr == '.' || *result.ptr == 'e' || *result.ptr == 'E')) {
+    return false;
+  }
+  pos += result.ptr - first;
+  return true;
+}
+
+bool JsonScanner::read_bool(bool& out) {
+  skip_whitespace();
+  if (skip_literal("true")) {
+    out = true;
+    return true;
+  }
+  if (skip_literal("false")) {
+    out = false;
+    return true;
+  }
+  return false;
+}
+
+bool JsonScanner::skip_literal(std::string_view literal) {
+  if (text.substr(pos, literal.size()) != literal) return false;
+  pos += literal.size();
+  return true;
+}
+
+bool JsonScanner::skip_string() {
+  ++pos;  // Opening quote
+  while (pos < text.size()) {
+    const char c = text[pos++];
+    if (c == '"') return true;
+    if (static_cast<unsigned char>(c) < 0x20) return false;
+    if (c == '\\') {
+      if (pos == text.size()) return false;
+      ++pos;  // Escapes are validated only when the string is read
+    }
+  }
+  return false;
+}
+
+bool JsonScanner::skip_number() {
+  auto is_digit = [this] {
+    return pos < text.size() && text[pos] >= '0' && text[pos] <= '9';
+  };
+  auto skip_digits = [&] {
+    if (!is_digit()) return false;
+    while (is_digit()) ++pos;
+    return true;
+  };
+
+  // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+  if (pos < text.size() && text[pos] == '-') ++pos;
+  if (pos < text.size() && text[pos] == '0') {
+    ++pos;
+  } else if (!skip_digits()) {
+    return false;
+  }
+  if (pos < text.size() && text[pos] == '.') {
+    ++pos;
+    if (!skip_digits()) return false;
+  }
+  if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+    ++pos;
+    if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) ++pos;
+    if (!skip_digits()) return false;
+  }
+  return true;
+}
+
+bool JsonScanner::skip_value() { return skip_value(0); }
+
+bool JsonScanner::skip_value(int depth) {
+  if (depth > kMaxDepth) return false;
+  switch (peek()) {
+    case '"':
+      return skip_string();
+    case 't':
+      return skip_literal("true");
+    case 'f':
+      return skip_literal("false");
+    case 'n':
+      return skip_literal("null");
+    case '{':
+      ++pos;
+      if (consume('}')) return true;
+      do {
+        if (peek() != '"' || !skip_string() || !consume(':') ||
+            !skip_value(depth + 1)) {
+          return false;
+        }
+      } while (consume(','));
+      return consume('}');
+    case '[':
+      ++pos;
+      if (consume(']')) return true;
+      do {
+        if (!skip_value(depth + 1)) return false;
+      } while (consume(','));
+      return consume(']');
+    default:
+      return skip_number();
+  }
+}
@@ -0,0 +1,71 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the fixed-rate tick loop
+
+#include "utils/tick_scheduler.hpp"
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include "utils/logger.hpp"
+
+TickScheduler::TickScheduler(std::string name,
+                             std::chrono::milliseconds period,
+                             std::function<void()> tick)
+    : name(std::move(name)),
+      period(std::max(period, std::chrono::milliseconds(1))),
+      tick(std::move(tick)),
+      duration(MetricsRegistry::instance().histogram(
+          "tick_duration_seconds", "Time spent running one simulation tick",
+          "loop=\"" + this->name + "\"")) {
+  thread = std::thread([this] { run(); });
+}
+
+TickScheduler::~TickScheduler() {
+  stop();
+}
+
+void TickScheduler::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  if (thread.joinable()) thread.join();
+}
+
+TickSchedulerStats TickScheduler::stats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return {ticks, overruns, skipped};
+}
+
+void TickScheduler::run() {
+  Clock::time_point next = Clock::now() + period;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      if (wake.wait_until(lock, next, [this] { return stopping; })) return;
+    }
+
+    const Clock::time_point started = Clock::now();
+    try {
+      tick();
+    } catch (const std::exception& e) {
+      LOG_ERROR << "Uncaught exception in " << name << " tick: " << e.what();
+    }
+    const Clock::time_point finished = Clock::now();
+    duration.record(finished - started);
+
+    // Missed ticks are dropped: the next one is the first still ahead
+    next += period;
+    std::uint64_t missed = 0;
+    if (finished >= next) {
+      missed = static_cast<std::uint64_t>((finished - next) / period);
+      next += period * missed;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ++ticks;
+    if (finished - started > period) ++overruns;
+    skipped += missed;
+  }
+}
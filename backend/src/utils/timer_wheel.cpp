@@ -0,0 +1,97 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the hierarchical timer wheel
+
+#include "utils/timer_wheel.hpp"
+
+namespace {
+
+constexpr std::uint64_t kSlotMask = TimerWheel::kSlots - 1;
+
+// Furthest deadline the wheel can place exactly, relative to now
+constexpr std::uint64_t kMaxSpan =
+    (std::uint64_t{1} << (TimerWheel::kSlotBits * TimerWheel::kLevels)) - 1;
+
+}  // namespace
+
+TimerWheel::TimerWheel() {
+  for (auto& level : levels) {
+    for (Slot& slot : level) slot.prev = slot.next = &slot;
+  }
+}
+
+TimerWheel::Slot& TimerWheel::slot_for(std::uint64_t deadline) {
+  // Deadlines beyond the top level park there and are re-examined when
+  // their slot is cascaded
+  std::uint64_t delta = deadline - current;
+  if (delta > kMaxSpan) {
+    delta = kMaxSpan;
+    deadline = current + kMaxSpan;
+  }
+
+  int level = 0;
+  while (level + 1 < kLevels && delta >= (std::uint64_t{1} << (kSlotBits * (level + 1)))) {
+    ++level;
+  }
+  return levels[level][(deadline >> (kSlotBits * level)) & kSlotMask];
+}
+
+void TimerWheel::link(Slot& slot, TimerNode* node) {
+  node->prev = slot.prev;
+  node->next = &slot;
+  slot.prev->next = node;
+  slot.prev = node;
+}
+
+void TimerWheel::schedule(TimerNode* node, std::uint64_t deadline) {
+  cancel(node);
+  node->deadline = deadline;
+  link(slot_for(deadline <= current ? current + 1 : deadline), node);
+  ++count;
+}
+
+void TimerWheel::cancel(TimerNode* node) {
+  if (!node->scheduled()) return;
+  node->prev->next = node->next;
+  node->next->prev = node->prev;
+  node->prev = node->next = nullptr;
+  --count;
+}
+
+void TimerWheel::cascade(Slot& slot) {
+  TimerNode* node = slot.next;
+  slot.prev = slot.next = &slot;
+  while (node != &slot) {
+    TimerNode* next = node->next;
+    link(slot_for(node->deadline), node);
+    node = next;
+  }
+}
+
+void TimerWheel::advance(std::uint64_t to,
+                         const std::function<void(TimerNode*)>& expired) {
+  while (current < to) {
+    ++current;
+
+    // When the lower bits roll over, the matching slot of each higher
+    // level comes due; cascade from the top so nodes can fall through
+    // several levels in one tick
+    for (int level = kLevels - 1; level > 0; --level) {
+      const std::uint64_t span_bits = kSlotBits * level;
+      if ((current & ((std::uint64_t{1} << span_bits) - 1)) == 0) {
+        cascade(levels[level][(current >> span_bits) & kSlotMask]);
+      }
+    }
+
+    Slot& slot = levels[0][current & kSlotMask];
+    while (slot.next != &slot) {
+      TimerNode* node = slot.next;
+      cancel(node);
+      if (node->deadline > current) {
+        // Parked beyond the wheel's span; place it again
+        schedule(node, node->deadline);
+      } else {
+        expired(node);
+      }
+    }
+  }
+}
@@ -0,0 +1,136 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of request traces and the trace exporter
+
+#include "utils/trace.hpp"
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+// Appends text as the contents of a JSON string
+void append_escaped(std::string& out, std::string_view text) {
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out += escaped;
+    } else {
+      out += c;
+    }
+  }
+}
+
+bool sampled(double rate) {
+  if (rate >= 1) return true;
+  if (rate <= 0) return false;
+  thread_local std::minstd_rand rng(std::random_device{}());
+  return std::uniform_real_distribution<double>(0, 1)(rng) < rate;
+}
+
+}  // namespace
+
+Trace::Trace(std::string request_id)
+    : id(std::move(request_id)),
+      start(Clock::now()),
+      wall_start(std::chrono::system_clock::now()) {}
+
+void Trace::add(const char* name, Clock::time_point from, Clock::time_point to) {
+  if (span_count == kMaxSpans) {
+    ++dropped;
+    return;
+  }
+  spans[span_count++] = {name, from - start, to - from};
+}
+
+TraceExporter::TraceExporter(const std::string& path, double sample_rate,
+                             std::chrono::milliseconds slow_threshold)
+    : file(path, std::ios::app),
+      sample_rate(sample_rate),
+      slow_threshold(slow_threshold) {
+  if (!file) {
+    throw std::runtime_error("Cannot open trace file " + path);
+  }
+  writer = std::thread([this] { run(); });
+}
+
+TraceExporter::~TraceExporter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_one();
+  writer.join();
+}
+
+void TraceExporter::finish(const Trace& trace, std::string_view method,
+                           std::string_view route, int status) {
+  const auto duration = Trace::Clock::now() - trace.started();
+  if (duration < slow_threshold && !sampled(sample_rate)) return;
+
+  std::string line;
+  line.reserve(256 + 64 * (trace.end() - trace.begin()));
+  line += "{\"requestId\":\"";
+  append_escaped(line, trace.request_id());
+  line += "\",\"method\":\"";
+  append_escaped(line, method);
+  line += "\",\"route\":\"";
+  append_escaped(line, route);
+  line += "\",\"status\":" + std::to_string(status);
+  line += ",\"timestamp\":" +
+          std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(
+                             trace.started_wall().time_since_epoch())
+                             .count());
+  line += ",\"durationNs\":" + std::to_string(duration.count());
+  line += ",\"spans\":[";
+  for (const TraceSpan* span = trace.begin(); span != trace.end(); ++span) {
+    if (span != trace.begin()) line += ',';
+    line += "{\"name\":\"";
+    append_escaped(line, span->name);
+    line += "\",\"startNs\":" + std::to_string(span->start.count());
+    line += ",\"durationNs\":" + std::to_string(span->duration.count()) + "}";
+  }
+  line += ']';
+  if (trace.dropped_spans() > 0) {
+    line += ",\"droppedSpans\":" + std::to_string(trace.dropped_spans());
+  }
+  line += "}\n";
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pending.size() >= kMaxPending) {
+      ++dropped;
+      return;
+    }
+    pending.push_back(std::move(line));
+  }
+  wake.notify_one();
+}
+
+TraceExporterStats TraceExporter::stats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return {exported, dropped};
+}
+
+void TraceExporter::run() {
+  std::deque<std::string> batch;
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    wake.wait(lock, [this] { return stopping || !pending.empty(); });
+    if (pending.empty()) return;  // Stopping and fully written
+    batch.swap(pending);
+
+    // Write without the lock so finish() never waits on the disk
+    lock.unlock();
+    for (const std::string& line : batch) file << line;
+    file.flush();
+    lock.lock();
+
+    exported += batch.size();
+    batch.clear();
+  }
+}
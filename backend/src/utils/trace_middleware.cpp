@@ -0,0 +1,54 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the request tracing middleware
+
+#include "utils/trace_middleware.hpp"
+#include <cstdio>
+#include <random>
+#include <utility>
+
+namespace {
+
+// Ids we accept from clients: up to 64 letters, digits, '-', '_' or '.'
+bool valid_request_id(const std::string& id) {
+  if (id.empty() || id.size() > 64) return false;
+  for (char c : id) {
+    const bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                    (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.';
+    if (!ok) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+TraceMiddleware::TraceMiddleware() : id_prefix(std::random_device{}()) {}
+
+std::string TraceMiddleware::next_id() {
+  char id[17];
+  std::snprintf(id, sizeof(id), "%08x%08x", id_prefix,
+                id_counter.fetch_add(1, std::memory_order_relaxed));
+  return id;
+}
+
+void TraceMiddleware::before_handle(crow::request& req, crow::response&,
+                                    context& ctx) {
+  std::string id = req.get_header_value("X-Request-Id");
+  ctx.request_id = valid_request_id(id) ? std::move(id) : next_id();
+  if (exporter) ctx.trace = std::make_shared<Trace>(ctx.request_id);
+}
+
+void TraceMiddleware::after_handle(crow::request& req, crow::response& res,
+                                   context& ctx) {
+  // Crow answers requests that match no route without calling
+  // before_handle
+  if (ctx.request_id.empty()) ctx.request_id = next_id();
+  res.set_header("X-Request-Id", ctx.request_id);
+
+  if (ctx.trace && exporter) {
+    exporter->finish(*ctx.trace, crow::method_name(req.method), req.url,
+                     res.code);
+  }
+  // Connections reuse the context of their previous request until the next
+  // one is routed
+  ctx = {};
+}
@@ -0,0 +1,118 @@
+// Copyright 2024 Pokemon Battle Arena Project
+// Implementation of the bounded worker pool
+
+#include "utils/worker_pool.hpp"
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include "utils/logger.hpp"
+
+WorkerPool::WorkerPool(std::string name, std::size_t threads,
+                       std::size_t queue_capacity)
+    : pool_name(std::move(name)),
+      queue_capacity(std::max<std::size_t>(queue_capacity, 1)),
+      queue_span(pool_name + ".queue"),
+      queue_wait(MetricsRegistry::instance().histogram(
+          "executor_queue_wait_seconds",
+          "Time tasks spent queued before a worker picked them up",
+          "pool=\"" + pool_name + "\"")),
+      task_latency(MetricsRegistry::instance().histogram(
+          "executor_task_duration_seconds",
+          "Time from submission until a task finished, queue wait included",
+          "pool=\"" + pool_name + "\"")) {
+  threads = std::max<std::size_t>(threads, 1);
+  workers.reserve(threads);
+  for (std::size_t i = 0; i < threads; ++i) {
+    workers.emplace_back([this] { worker_loop(); });
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  shutdown();
+}
+
+bool WorkerPool::try_submit(Task task) {
+  Trace* trace = Trace::current();
+  std::shared_ptr<Trace> shared_trace =
+      trace ? trace->shared_from_this() : nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopping || queue.size() >= queue_capacity) {
+      ++rejected;
+      return false;
+    }
+    queue.push_back({std::move(task), Clock::now(), std::move(shared_trace)});
+    ++submitted;
+    peak_queue_depth = std::max(peak_queue_depth, queue.size());
+  }
+  not_empty.notify_one();
+  return true;
+}
+
+void WorkerPool::shutdown(Clock::time_point deadline) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    drop_after = std::min(drop_after, deadline);
+  }
+  not_empty.notify_all();
+  for (auto& worker : workers) {
+    if (worker.joinable()) worker.join();
+  }
+}
+
+void WorkerPool::worker_loop() {
+  while (true) {
+    QueuedTask next;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      not_empty.wait(lock, [this] { return stopping || !queue.empty(); });
+      if (queue.empty()) return;  // Stopping and fully drained
+      if (stopping && Clock::now() >= drop_after) {
+        dropped += queue.size();
+        LOG_WARNING << "Dropping " << queue.size() << " queued " << pool_name
+                    << " tasks at the shutdown deadline";
+        queue.clear();
+        return;
+      }
+      next = std::move(queue.front());
+      queue.pop_front();
+      ++active;
+    }
+
+    const auto picked_up = Clock::now();
+    const auto waited = picked_up - next.enqueued_at;
+    queue_wait.record(waited);
+    ActiveTrace traced(next.trace);
+    if (next.trace) {
+      next.trace->add(queue_span.c_str(), next.enqueued_at, picked_up);
+    }
+    const auto wait_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(waited).count();
+    try {
+      next.task();
+    } catch (const std::exception& e) {
+      // Tasks are expected to report their own failures; never let one
+      // take a worker thread down with it.
+      LOG_ERROR << "Uncaught exception in " << pool_name
+                 << " worker: " << e.what();
+    } catch (...) {
+      LOG_ERROR << "Uncaught exception in " << pool_name << " worker";
+    }
+    task_latency.record(Clock::now() - next.enqueued_at);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    --active;
+    ++completed;
+    total_wait_us += static_cast<std::uint64_t>(wait_us);
+    max_wait_us = std::max(max_wait_us, static_cast<std::uint64_t>(wait_us));
+  }
+}
+
+WorkerPoolStats WorkerPool::stats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return {workers.size(), queue_capacity, queue.size(), peak_queue_depth,
+          active, submitted, rejected, completed, dropped, total_wait_us,
+          max_wait_us};
+}